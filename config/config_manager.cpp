@@ -82,6 +82,7 @@ void ConfigManager::parse(const QJsonObject& o) {
     if (o.contains(QStringLiteral("transport"))) {
         const auto t = o.value(QStringLiteral("transport")).toObject();
         transport.default_protocol = t.value(QStringLiteral("default")).toString(transport.default_protocol);
+        transport.intra_process = t.value(QStringLiteral("intra_process")).toBool(transport.intra_process);
 
         // UDP
         if (t.contains(QStringLiteral("udp"))) {
@@ -89,6 +90,36 @@ void ConfigManager::parse(const QJsonObject& o) {
             transport.udp.port   = static_cast<quint16>(u.value(QStringLiteral("port")).toInt(transport.udp.port));
             transport.udp.rcvbuf = u.value(QStringLiteral("rcvbuf")).toInt(transport.udp.rcvbuf);
             transport.udp.sndbuf = u.value(QStringLiteral("sndbuf")).toInt(transport.udp.sndbuf);
+            transport.udp.gso = u.value(QStringLiteral("gso")).toBool(transport.udp.gso);
+            transport.udp.io_thread = u.value(QStringLiteral("io_thread")).toBool(transport.udp.io_thread);
+            transport.udp.rx_ring = qBound(2, u.value(QStringLiteral("rx_ring")).toInt(transport.udp.rx_ring), 65536);
+            transport.udp.rx_batch = qBound(1, u.value(QStringLiteral("rx_batch")).toInt(transport.udp.rx_batch), 1024);
+
+            if (u.contains(QStringLiteral("multicast"))) {
+                auto& mc = transport.udp.multicast;
+                const auto m = u.value(QStringLiteral("multicast")).toObject();
+                mc.enabled  = m.value(QStringLiteral("enabled")).toBool(mc.enabled);
+                mc.ttl      = m.value(QStringLiteral("ttl")).toInt(mc.ttl);
+                mc.loopback = m.value(QStringLiteral("loopback")).toBool(mc.loopback);
+                const QHostAddress base(m.value(QStringLiteral("group_base")).toString(mc.group_base.toString()));
+                const quint32 ip = base.toIPv4Address();
+                if (ip >= 0xE0000000 && ip <= 0xEFFFFFFF) {
+                    mc.group_base = base;
+                } else {
+                    qWarning() << "[Config] transport.udp.multicast.group_base is not an IPv4 multicast address:" << base.toString();
+                }
+                mc.topic_groups.clear();
+                const auto groups = m.value(QStringLiteral("topics")).toObject();
+                for (auto it = groups.begin(); it != groups.end(); ++it) {
+                    const QHostAddress group(it.value().toString());
+                    const quint32 gip = group.toIPv4Address();
+                    if (gip >= 0xE0000000 && gip <= 0xEFFFFFFF) {
+                        mc.topic_groups.insert(it.key(), group);
+                    } else {
+                        qWarning() << "[Config] transport.udp.multicast.topics: bad group for" << it.key() << ":" << it.value().toString();
+                    }
+                }
+            }
         }
 
         // TCP
@@ -135,6 +166,21 @@ void ConfigManager::parse(const QJsonObject& o) {
             qos_cfg.reliable.max_retries    = r.value(QStringLiteral("max_retries")).toInt(qos_cfg.reliable.max_retries);
             qos_cfg.reliable.exponential_backoff = r.value(QStringLiteral("exponential_backoff"))
                                                     .toBool(qos_cfg.reliable.exponential_backoff);
+            qos_cfg.reliable.ack_delay_ms = qMax(0, r.value(QStringLiteral("ack_delay_ms")).toInt(qos_cfg.reliable.ack_delay_ms));
+            qos_cfg.reliable.adaptive_rto = r.value(QStringLiteral("adaptive_rto")).toBool(qos_cfg.reliable.adaptive_rto);
+            qos_cfg.reliable.min_rto_ms = qMax(1, r.value(QStringLiteral("min_rto_ms")).toInt(qos_cfg.reliable.min_rto_ms));
+            qos_cfg.reliable.max_rto_ms = qMax(qos_cfg.reliable.min_rto_ms,
+                                               r.value(QStringLiteral("max_rto_ms")).toInt(qos_cfg.reliable.max_rto_ms));
+            qos_cfg.reliable.window_initial = qMax(1, r.value(QStringLiteral("window_initial")).toInt(qos_cfg.reliable.window_initial));
+            qos_cfg.reliable.max_in_flight = qMax(qos_cfg.reliable.window_initial,
+                                                  r.value(QStringLiteral("max_in_flight")).toInt(qos_cfg.reliable.max_in_flight));
+            qos_cfg.reliable.max_queue = qMax(0, r.value(QStringLiteral("max_queue")).toInt(qos_cfg.reliable.max_queue));
+        }
+        if (q.contains(QStringLiteral("nack"))) {
+            const auto n = q.value(QStringLiteral("nack")).toObject();
+            qos_cfg.nack.history_depth = qMax(1, n.value(QStringLiteral("history_depth")).toInt(qos_cfg.nack.history_depth));
+            qos_cfg.nack.heartbeat_ms = qMax(1, n.value(QStringLiteral("heartbeat_ms")).toInt(qos_cfg.nack.heartbeat_ms));
+            qos_cfg.nack.nack_delay_ms = qMax(0, n.value(QStringLiteral("nack_delay_ms")).toInt(qos_cfg.nack.nack_delay_ms));
         }
         qos_cfg.dedup_capacity = q.value(QStringLiteral("dedup_capacity")).toInt(qos_cfg.dedup_capacity);
         if (q.contains(QStringLiteral("retain_last"))) {
@@ -162,11 +208,12 @@ void ConfigManager::parse(const QJsonObject& o) {
                 if (v.isString()) serialization.supported << v.toString();
             }
         } else {
-            // Default: put our format first, then the other
+            // Default: put our format first, then the others
             serialization.supported.clear();
             serialization.supported << serialization.format;
-            if (serialization.format == "json") serialization.supported << "cbor";
-            else serialization.supported << "json";
+            for (const QString& f : {QStringLiteral("json"), QStringLiteral("cbor"), QStringLiteral("bin")}) {
+                if (f != serialization.format) serialization.supported << f;
+            }
         }
         if (s.contains(QStringLiteral("allow_json_fallback"))) {
             serialization.allow_json_fallback = s.value(QStringLiteral("allow_json_fallback")).toBool(serialization.allow_json_fallback);
@@ -179,6 +226,7 @@ void ConfigManager::parse(const QJsonObject& o) {
         logging.level = l.value(QStringLiteral("level")).toString(logging.level);
         logging.file  = l.value(QStringLiteral("file")).toString(logging.file);
         logging.deadletter_file = l.value(QStringLiteral("deadletter_file")).toString(logging.deadletter_file);
+        logging.deadletter_packets = l.value(QStringLiteral("deadletter_packets")).toBool(logging.deadletter_packets);
     }
 }
 
@@ -275,6 +323,11 @@ void ConfigManager::onConfigFileChanged() {
     if (transport.udp.port != oldTransport.udp.port) qWarning() << "[Config] transport.udp.port changed but not reloadable";
     if (transport.udp.rcvbuf != oldTransport.udp.rcvbuf) qWarning() << "[Config] transport.udp.rcvbuf changed but not reloadable";
     if (transport.udp.sndbuf != oldTransport.udp.sndbuf) qWarning() << "[Config] transport.udp.sndbuf changed but not reloadable";
+    if (transport.udp.io_thread != oldTransport.udp.io_thread) qWarning() << "[Config] transport.udp.io_thread changed but not reloadable";
+    if (transport.udp.rx_ring != oldTransport.udp.rx_ring) qWarning() << "[Config] transport.udp.rx_ring changed but not reloadable";
+    if (transport.udp.gso != oldTransport.udp.gso) qWarning() << "[Config] transport.udp.gso changed but not reloadable";
+    if (transport.udp.rx_batch != oldTransport.udp.rx_batch) qWarning() << "[Config] transport.udp.rx_batch changed but not reloadable";
+    if (transport.udp.multicast.enabled != oldTransport.udp.multicast.enabled) qWarning() << "[Config] transport.udp.multicast.enabled changed but not reloadable";
     if (transport.tcp.listen != oldTransport.tcp.listen) qWarning() << "[Config] transport.tcp.listen changed but not reloadable";
     if (transport.tcp.port != oldTransport.tcp.port) qWarning() << "[Config] transport.tcp.port changed but not reloadable";
     if (transport.tcp.rcvbuf != oldTransport.tcp.rcvbuf) qWarning() << "[Config] transport.tcp.rcvbuf changed but not reloadable";
@@ -287,7 +340,7 @@ void ConfigManager::onConfigFileChanged() {
     if (qos_cfg.reliable.ack_timeout_ms != oldQos.reliable.ack_timeout_ms) qWarning() << "[Config] qos.reliable.ack_timeout_ms changed but not reloadable";
     if (qos_cfg.reliable.max_retries != oldQos.reliable.max_retries) qWarning() << "[Config] qos.reliable.max_retries changed but not reloadable";
     if (qos_cfg.reliable.exponential_backoff != oldQos.reliable.exponential_backoff) qWarning() << "[Config] qos.reliable.exponential_backoff changed but not reloadable";
-    if (qos_cfg.dedup_capacity != oldQos.dedup_capacity) qWarning() << "[Config] qos.dedup_capacity changed but not reloadable";
+    if (qos_cfg.nack.history_depth != oldQos.nack.history_depth) qWarning() << "[Config] qos.nack.history_depth changed but not reloadable";
     if (serialization.format != oldSerialization.format) qWarning() << "[Config] serialization.format changed but not reloadable";
     if (topics_list != oldTopics) qWarning() << "[Config] topics changed but not reloadable";
     if (logging.file != oldLogFile) qWarning() << "[Config] logging.file changed but not reloadable";
@@ -313,8 +366,21 @@ void ConfigManager::applyReloadableDiff(const ConfigManager& oldCfg) {
     if (qos_cfg.reliable.ack_timeout_ms != oldCfg.qos_cfg.reliable.ack_timeout_ms ||
         qos_cfg.reliable.max_retries != oldCfg.qos_cfg.reliable.max_retries ||
         qos_cfg.reliable.exponential_backoff != oldCfg.qos_cfg.reliable.exponential_backoff ||
+        qos_cfg.reliable.ack_delay_ms != oldCfg.qos_cfg.reliable.ack_delay_ms ||
+        qos_cfg.reliable.adaptive_rto != oldCfg.qos_cfg.reliable.adaptive_rto ||
+        qos_cfg.reliable.min_rto_ms != oldCfg.qos_cfg.reliable.min_rto_ms ||
+        qos_cfg.reliable.max_rto_ms != oldCfg.qos_cfg.reliable.max_rto_ms ||
+        qos_cfg.reliable.window_initial != oldCfg.qos_cfg.reliable.window_initial ||
+        qos_cfg.reliable.max_in_flight != oldCfg.qos_cfg.reliable.max_in_flight ||
+        qos_cfg.reliable.max_queue != oldCfg.qos_cfg.reliable.max_queue ||
+        qos_cfg.nack.heartbeat_ms != oldCfg.qos_cfg.nack.heartbeat_ms ||
+        qos_cfg.nack.nack_delay_ms != oldCfg.qos_cfg.nack.nack_delay_ms ||
         qos_cfg.retain_last != oldCfg.qos_cfg.retain_last) {
         qCInfo(LogCore) << "[Config] QoS settings reloaded";
     }
+    // transport.intra_process is checked on every publish
+    if (transport.intra_process != oldCfg.transport.intra_process) {
+        qCInfo(LogCore) << "[Config] transport.intra_process =" << transport.intra_process;
+    }
     emit reloaded();
 }
@@ -0,0 +1,203 @@
+#include "content_filter.h"
+#include <QStringList>
+
+// Recursive descent over the expression text, emitting nodes as it goes:
+//   or   := and (OR and)*
+//   and  := not (AND not)*
+//   not  := NOT not | '(' or ')' | field op literal
+class ContentFilterParser {
+public:
+    ContentFilterParser(const QString& text, ContentFilter& out) : s(text), f(out) {}
+
+    bool parse(QString* error) {
+        f.root = parseOr();
+        skipSpace();
+        if (err.isEmpty() && i < s.size()) fail(QStringLiteral("unexpected '%1'").arg(s.mid(i, 12)));
+        if (!err.isEmpty()) {
+            if (error) *error = QStringLiteral("%1 at offset %2").arg(err).arg(errAt);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    using Op = ContentFilter::Op;
+
+    int parseOr() {
+        int lhs = parseAnd();
+        while (err.isEmpty() && keyword("OR")) lhs = add(Op::Or, lhs, parseAnd());
+        return lhs;
+    }
+
+    int parseAnd() {
+        int lhs = parseNot();
+        while (err.isEmpty() && keyword("AND")) lhs = add(Op::And, lhs, parseNot());
+        return lhs;
+    }
+
+    int parseNot() {
+        if (!err.isEmpty()) return -1;
+        if (keyword("NOT")) return add(Op::Not, parseNot(), -1);
+        skipSpace();
+        if (i < s.size() && s[i] == QLatin1Char('(')) {
+            ++i;
+            const int inner = parseOr();
+            skipSpace();
+            if (i >= s.size() || s[i] != QLatin1Char(')')) return fail(QStringLiteral("expected ')'"));
+            ++i;
+            return inner;
+        }
+        return parseComparison();
+    }
+
+    int parseComparison() {
+        const QString field = identifier();
+        if (field.isEmpty()) return fail(QStringLiteral("expected a field name"));
+        skipSpace();
+        Op op;
+        if (take("==") || take("=")) op = Op::Eq;
+        else if (take("!=") || take("<>")) op = Op::Ne;
+        else if (take("<=")) op = Op::Le;
+        else if (take(">=")) op = Op::Ge;
+        else if (take("<")) op = Op::Lt;
+        else if (take(">")) op = Op::Gt;
+        else return fail(QStringLiteral("expected a comparison after '%1'").arg(field));
+        ContentFilter::Node n;
+        n.op = op;
+        n.path = field.split(QLatin1Char('.'));
+        if (!literal(&n.literal)) return fail(QStringLiteral("expected a number, 'string', true or false"));
+        f.nodes.append(n);
+        return int(f.nodes.size()) - 1;
+    }
+
+    int add(Op op, int lhs, int rhs) {
+        if (!err.isEmpty()) return -1;
+        ContentFilter::Node n;
+        n.op = op;
+        n.lhs = lhs;
+        n.rhs = rhs;
+        f.nodes.append(n);
+        return int(f.nodes.size()) - 1;
+    }
+
+    void skipSpace() {
+        while (i < s.size() && s[i].isSpace()) ++i;
+    }
+
+    bool take(const char* token) {
+        const QLatin1String t(token);
+        if (!QStringView(s).mid(i).startsWith(t)) return false;
+        i += t.size();
+        return true;
+    }
+
+    // Case-insensitive, and only as a whole word ("ORDER" is a field)
+    bool keyword(const char* word) {
+        skipSpace();
+        const QLatin1String w(word);
+        if (!QStringView(s).mid(i).startsWith(w, Qt::CaseInsensitive)) return false;
+        const qsizetype end = i + w.size();
+        if (end < s.size() && (s[end].isLetterOrNumber() || s[end] == QLatin1Char('_'))) return false;
+        i = end;
+        return true;
+    }
+
+    QString identifier() {
+        skipSpace();
+        const qsizetype start = i;
+        while (i < s.size() && (s[i].isLetterOrNumber() || s[i] == QLatin1Char('_') || s[i] == QLatin1Char('.'))) ++i;
+        return s.mid(start, i - start);
+    }
+
+    bool literal(QJsonValue* out) {
+        skipSpace();
+        if (i >= s.size()) return false;
+        if (s[i] == QLatin1Char('\'')) {
+            QString str;
+            for (++i; i < s.size(); ++i) {
+                if (s[i] != QLatin1Char('\'')) { str += s[i]; continue; }
+                if (i + 1 < s.size() && s[i + 1] == QLatin1Char('\'')) { str += s[i++]; continue; }
+                ++i;
+                *out = str;
+                return true;
+            }
+            return false; // unterminated
+        }
+        if (keyword("true")) { *out = true; return true; }
+        if (keyword("false")) { *out = false; return true; }
+        const qsizetype start = i;
+        while (i < s.size() && (s[i].isDigit() || s[i] == QLatin1Char('-') || s[i] == QLatin1Char('+') ||
+                                s[i] == QLatin1Char('.') || s[i] == QLatin1Char('e') || s[i] == QLatin1Char('E'))) {
+            ++i;
+        }
+        bool ok = false;
+        const double d = QStringView(s).mid(start, i - start).toDouble(&ok);
+        if (!ok) { i = start; return false; }
+        *out = d;
+        return true;
+    }
+
+    int fail(const QString& what) {
+        if (err.isEmpty()) {
+            err = what;
+            errAt = int(i);
+        }
+        return -1;
+    }
+
+    const QString& s;
+    ContentFilter& f;
+    qsizetype i = 0;
+    QString err;
+    int errAt = 0;
+};
+
+std::optional<ContentFilter> ContentFilter::compile(const QString& expression, QString* error) {
+    ContentFilter f;
+    f.text = expression.trimmed();
+    if (f.text.isEmpty()) {
+        if (error) *error = QStringLiteral("empty filter");
+        return std::nullopt;
+    }
+    ContentFilterParser parser(f.text, f);
+    if (!parser.parse(error)) return std::nullopt;
+    return f;
+}
+
+bool ContentFilter::matches(const QJsonObject& payload) const {
+    return root >= 0 && eval(root, payload);
+}
+
+bool ContentFilter::eval(int n, const QJsonObject& payload) const {
+    const Node& node = nodes[n];
+    switch (node.op) {
+    case Op::And: return eval(node.lhs, payload) && eval(node.rhs, payload);
+    case Op::Or:  return eval(node.lhs, payload) || eval(node.rhs, payload);
+    case Op::Not: return !eval(node.lhs, payload);
+    default: break;
+    }
+    QJsonValue v = payload.value(node.path.first());
+    for (int k = 1; k < node.path.size() && v.isObject(); ++k) v = v.toObject().value(node.path[k]);
+    const QJsonValue& lit = node.literal;
+    int cmp;
+    if (v.isDouble() && lit.isDouble()) {
+        const double a = v.toDouble(), b = lit.toDouble();
+        cmp = a < b ? -1 : a > b ? 1 : 0;
+    } else if (v.isString() && lit.isString()) {
+        cmp = v.toString().compare(lit.toString());
+    } else if (v.isBool() && lit.isBool()) {
+        if (node.op != Op::Eq && node.op != Op::Ne) return false;
+        cmp = v.toBool() == lit.toBool() ? 0 : 1;
+    } else {
+        return false; // missing, null, or another type
+    }
+    switch (node.op) {
+    case Op::Eq: return cmp == 0;
+    case Op::Ne: return cmp != 0;
+    case Op::Lt: return cmp < 0;
+    case Op::Le: return cmp <= 0;
+    case Op::Gt: return cmp > 0;
+    case Op::Ge: return cmp >= 0;
+    default:     return false;
+    }
+}
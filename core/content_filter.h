@@ -0,0 +1 @@
+#include "../include/content_filter.h"
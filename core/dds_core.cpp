@@ -14,6 +14,9 @@
 #include <QCoreApplication>
 #include <QEventLoop>
 #include <QMap>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <utility>
 
 
 
@@ -25,168 +28,485 @@ DDSCore::DDSCore(const QString& nodeId, const QString& proto,
     protocol(proto),
     net(transport),
     ack(ackMgr),
-    seenMessages(ConfigManager::ref().qos_cfg.dedup_capacity)
-    , perTopicDedup()
-    , discoveryManager(nullptr)
+    discoveryManager(nullptr),
+    incarnation(1u + QRandomGenerator::global()->bounded(0xFFFFFFFEu))
 {
     connect(net, &ITransport::datagramReceived, this, &DDSCore::onDatagram);
+    connect(net, &ITransport::datagramsReceived, this, &DDSCore::onDatagramBatch);
     if (ack) {
-        connect(ack, &AckManager::resend, this, &DDSCore::resendPacket);
+        connect(ack, &AckManager::resendBatch, this, &DDSCore::resendPackets);
+        connect(ack, &AckManager::dispatch, this, &DDSCore::sendQueued);
+        connect(ack, &AckManager::backpressure, this, &DDSCore::backpressureChanged);
         connect(ack, &AckManager::failed, this, &DDSCore::onAckFailed);
     }
+    // Configured topics are known from the start: their samples are kept for a
+    // late subscriber even before anyone here declares them
+    for (const QString& topic : ConfigManager::ref().topics_list) {
+        state(TopicRegistry::instance().intern(topic));
+        joinTopicGroup(topic);
+    }
+    ackFlushTimer.setSingleShot(true);
+    connect(&ackFlushTimer, &QTimer::timeout, this, &DDSCore::flushAcks);
+    nackFlushTimer.setSingleShot(true);
+    connect(&nackFlushTimer, &QTimer::timeout, this, &DDSCore::flushNacks);
+    connect(&heartbeatTimer, &QTimer::timeout, this, &DDSCore::sendHeartbeats);
+    connect(&replayTimer, &QTimer::timeout, this, &DDSCore::replayTick);
+}
+
+static QString formatName(WireFormat f) {
+    return f == WireFormat::Binary ? QStringLiteral("bin") : f == WireFormat::Cbor ? QStringLiteral("cbor") : QStringLiteral("json");
+}
+
+// Heartbeats sent after the last write to a reliable_nack topic, so readers
+// notice a lost tail sample.
+static constexpr int kHeartbeatsAfterWrite = 3;
+
+// --- multicast groups ---
+QHostAddress DDSCore::multicastGroupFor(const QString& topic) {
+    const auto& mc = ConfigManager::ref().transport.udp.multicast;
+    if (!mc.enabled) return QHostAddress();
+    const auto explicitGroup = mc.topic_groups.constFind(topic);
+    if (explicitGroup != mc.topic_groups.constEnd()) return *explicitGroup;
+    // FNV-1a over the UTF-8 topic name picks a stable host octet in group_base/24,
+    // so every node maps a topic to the same group without coordination.
+    quint32 h = 2166136261u;
+    for (char c : topic.toUtf8()) {
+        h ^= static_cast<quint8>(c);
+        h *= 16777619u;
+    }
+    const quint32 base = mc.group_base.toIPv4Address() & 0xFFFFFF00u;
+    return QHostAddress(base | (1u + h % 254u));
+}
+
+void DDSCore::joinTopicGroup(const QString& topic) {
+    const QHostAddress group = multicastGroupFor(topic);
+    if (group.isNull() || joinedTopics.contains(topic)) return;
+    if (net->joinGroup(group)) {
+        joinedTopics.insert(topic);
+    } else {
+        qCWarning(LogNet) << "[MCAST] could not join" << group.toString() << "for topic" << topic;
+    }
+}
+
+// The last local subscriber is gone; configured topics stay joined
+void DDSCore::leaveTopicGroup(const QString& topic) {
+    if (ConfigManager::ref().topics_list.contains(topic) || !joinedTopics.remove(topic)) return;
+    const QHostAddress group = multicastGroupFor(topic);
+    if (!group.isNull()) net->leaveGroup(group);
+}
+
+// Group datagrams go to the data port each reader advertised, once per
+// distinct port; with no reader known yet, to our own (the usual shared one).
+QVector<quint16> DDSCore::groupPorts(const QVector<PeerRoute>& routes) {
+    QVector<quint16> ports;
+    for (const PeerRoute& r : routes) {
+        if (!ports.contains(r.port)) ports << r.port;
+    }
+    if (ports.isEmpty()) ports << ConfigManager::ref().transport.udp.port;
+    return ports;
+}
+
+// --- per-topic state ---
+DDSCore::TopicState& DDSCore::state(TopicId id) {
+    Q_ASSERT(id != 0);
+    if (int(id) > topicStates.size()) topicStates.resize(int(id));
+    TopicState& st = topicStates[int(id) - 1];
+    if (st.info.name.isEmpty()) {
+        st.id = id;
+        st.info.name = TopicRegistry::instance().name(id);
+        attachFilters(st);
+    }
+    return st;
+}
+
+const DDSCore::TopicState* DDSCore::findState(TopicId id) const {
+    if (id == 0 || int(id) > topicStates.size()) return nullptr;
+    const TopicState& st = topicStates[int(id) - 1];
+    return st.info.name.isEmpty() ? nullptr : &st; // slot exists, topic never used here
+}
+
+DDSCore::TopicState* DDSCore::findState(TopicId id) {
+    return const_cast<TopicState*>(std::as_const(*this).findState(id));
+}
+
+// A new topic picks up the filters that already match it
+void DDSCore::attachFilters(TopicState& st) {
+    QVector<quint64> handles = localFilters.match(st.info.name);
+    if (!handles.isEmpty()) {
+        std::sort(handles.begin(), handles.end()); // handles rise with subscription order
+        handles.erase(std::unique(handles.begin(), handles.end()), handles.end());
+        for (quint64 h : std::as_const(handles)) st.subs.append(filterSubs.value(h).sub);
+        joinTopicGroup(st.info.name);
+    }
+    for (const QString& pid : peerFilters.match(st.info.name)) {
+        const auto e = routePeers.constFind(pid);
+        if (e != routePeers.constEnd()) addRoute(st, *e);
+    }
+}
+
+void DDSCore::addRoute(TopicState& st, const PeerEntry& e) {
+    for (const PeerRoute& r : std::as_const(st.routes)) {
+        if (r.peer == e.route.peer) return; // named the topic and a filter for it
+    }
+    PeerRoute r = e.route;
+    r.topicRef = r.topicEpoch ? e.topicIds.value(st.info.name) : 0;
+    r.where = e.where.value(st.info.name);
+    st.routes.append(r);
+}
+
+int DDSCore::subscriberCount(const QString& topic) const {
+    const TopicState* st = findState(TopicRegistry::instance().find(topic));
+    return st ? int(st->subs.size()) : 0;
 }
 
 class Publisher DDSCore::makePublisher(const QString& topic) {
-    if (!topics.contains(topic)) { TopicInfo t; t.name = topic; topics.insert(topic, t); }
+    const TopicId id = TopicRegistry::instance().intern(topic);
+    TopicState& st = state(id);
+    st.declared = true;
     // Log peer count for this topic
-    if (discoveryManager) {
-        int count = 0;
-        for (const auto& peer : discoveryManager->list_peers()) {
-            if (peer.topics.contains(topic)) ++count;
-        }
-        qInfo(LogDisc) << "makePublisher: topic=" << topic << "peers advertising this topic:" << count;
-    }
+    qInfo(LogDisc) << "makePublisher: topic=" << topic << "peers advertising this topic:" << st.routes.size();
     return Publisher(*this, topic);
 }
 
 // --- makeSubscriber ---
 class Subscriber DDSCore::makeSubscriber(const QString& topic, Subscriber::Callback cb) {
-    Subscriber s(*this, topic, cb);
-    // فقط callback را ذخیره می‌کنیم
-    subs.insert(topic, cb);
+    return makeSubscriber(topic, QString(), std::move(cb));
+}
 
-    if (!topics.contains(topic)) { TopicInfo t; t.name = topic; topics.insert(topic, t); }
-    topics[topic].subscribers << "local";
-    // Log peer count for this topic
-    if (discoveryManager) {
-        int count = 0;
-        for (const auto& peer : discoveryManager->list_peers()) {
-            if (peer.topics.contains(topic)) ++count;
+class Subscriber DDSCore::makeSubscriber(const QString& topic, const QString& contentFilter, Subscriber::Callback cb) {
+    LocalSubscription sub{0, cb, nullptr};
+    if (!contentFilter.trimmed().isEmpty()) {
+        QString error;
+        auto compiled = ContentFilter::compile(contentFilter, &error);
+        if (!compiled) {
+            qCWarning(LogCore) << "makeSubscriber: bad content filter for" << topic << ":" << error;
+            return Subscriber(*this, topic, cb);
         }
-        qInfo(LogDisc) << "makeSubscriber: topic=" << topic << "peers advertising this topic:" << count;
+        sub.where = std::make_shared<const ContentFilter>(std::move(*compiled));
+    }
+    if (TopicTrie<quint64>::isPattern(topic)) return subscribeFilter(topic, sub);
+    const TopicId tid = TopicRegistry::instance().intern(topic);
+    sub.id = nextSubscriptionId++;
+    Subscriber s(*this, topic, cb, sub.id);
+    TopicState& st = state(tid);
+    st.subs.append(sub);
+    subscriptionTopics.insert(sub.id, tid);
+
+    st.declared = true;
+    st.info.subscribers << "local";
+    joinTopicGroup(topic);
+    // Log peer count for this topic
+    qInfo(LogDisc) << "makeSubscriber: topic=" << topic << "peers advertising this topic:" << st.routes.size();
+    advertiseContentFilters();
+    catchUp(st, sub);
+    return s;
+}
+
+// Filters are advertised as they are; every topic we know that matches gets
+// the subscription now, later ones when their TopicState is created.
+class Subscriber DDSCore::subscribeFilter(const QString& filter, const LocalSubscription& base) {
+    if (!TopicTrie<quint64>::isValidFilter(filter)) {
+        qCWarning(LogCore) << "makeSubscriber: invalid topic filter" << filter << "('+'/'#' must be a whole level, '#' the last)";
+        return Subscriber(*this, filter, base.cb);
+    }
+    const quint64 id = nextSubscriptionId++;
+    LocalSubscription sub = base;
+    sub.id = id;
+    Subscriber s(*this, filter, sub.cb, id);
+    filterSubs.insert(id, FilterSubscription{filter, sub});
+    localFilters.insert(filter, id);
+    subscriptionTopics.insert(id, 0);
+    int matched = 0;
+    // By index: a catch-up callback may create topics, which attachFilters()
+    // already gives this subscription
+    for (int i = 0; i < topicStates.size(); ++i) {
+        TopicState& st = topicStates[i];
+        if (st.info.name.isEmpty() || !TopicTrie<quint64>::matches(filter, st.info.name)) continue;
+        if (std::any_of(st.subs.cbegin(), st.subs.cend(), [id](const LocalSubscription& l) { return l.id == id; })) continue;
+        st.subs.append(sub);
+        joinTopicGroup(st.info.name);
+        ++matched;
+        catchUp(st, sub);
+    }
+    qInfo(LogDisc) << "makeSubscriber: filter=" << filter << "matches known topics:" << matched;
+    advertiseContentFilters(); // an unfiltered match lifts a topic's advertised filters
+    return s;
+}
+
+// Catch-up goes to the new subscriber only; existing ones already saw it.
+// Calls the callback last, so `st` may be gone afterwards.
+void DDSCore::catchUp(TopicState& st, const LocalSubscription& sub) {
+    const QString topic = st.info.name;
+    if (st.lastUndelivered) {
+        // Newest remote sample arrived while nobody was subscribed; decode it now
+        const EnvelopeView v = *std::exchange(st.lastUndelivered, std::nullopt);
+        st.lastMsg = LastSample{v.payload(), v.qos, v.message_id};
     }
-    if (lastMsg.contains(topic) && cb) {
-        QJsonObject enriched = lastMsg.value(topic);
+    const Subscriber::Callback& cb = sub.cb;
+    if (!cb) return;
+    if (ConfigManager::ref().qos_cfg.retain_last && st.retained) {
+        const MessageEnvelope& m = *st.retained;
+        if (sub.where && !sub.where->matches(m.payload)) return;
+        QJsonObject enriched = m.payload;
         enriched["topic"] = topic;
-        enriched["qos"] = "best_effort"; // or something, but since it's lastMsg, perhaps not needed
-        enriched["message_id"] = 0; // placeholder
+        enriched["qos"] = m.qos;
+        enriched["message_id"] = m.message_id;
+        cb(enriched);
+    } else if (st.lastMsg) {
+        const LastSample& last = *st.lastMsg;
+        if (sub.where && !sub.where->matches(last.payload)) return;
+        QJsonObject enriched = last.payload;
+        enriched["topic"] = topic;
+        enriched["qos"] = last.qos;
+        enriched["message_id"] = last.message_id;
         cb(enriched);
     }
-    deliverRetainLast(topic, ConfigManager::ref().node_id);
-    return s;
+}
+
+bool DDSCore::unsubscribe(quint64 handle) {
+    const auto t = subscriptionTopics.constFind(handle);
+    if (t == subscriptionTopics.constEnd()) return false;
+    const TopicId tid = *t;
+    subscriptionTopics.erase(t);
+    const auto mine = [handle](const LocalSubscription& l) { return l.id == handle; };
+    if (tid == 0) {
+        const FilterSubscription f = filterSubs.take(handle);
+        localFilters.remove(f.filter, handle);
+        for (TopicState& st : topicStates) {
+            if (st.subs.removeIf(mine) && st.subs.isEmpty()) leaveTopicGroup(st.info.name);
+        }
+        advertiseContentFilters();
+        return true;
+    }
+    TopicState& st = state(tid);
+    st.subs.removeIf(mine);
+    st.info.subscribers.removeOne(QStringLiteral("local"));
+    if (st.subs.isEmpty()) leaveTopicGroup(st.info.name);
+    advertiseContentFilters();
+    return true;
+}
+
+QHash<QString, QStringList> DDSCore::advertisedContentFilters() const {
+    QHash<QString, QStringList> out;
+    for (const TopicState& st : topicStates) {
+        if (!st.declared || st.subs.isEmpty()) continue;
+        QStringList exprs;
+        for (const LocalSubscription& l : st.subs) {
+            if (!l.where) { exprs.clear(); break; } // someone takes everything
+            exprs << l.where->expression();
+        }
+        exprs.removeDuplicates();
+        if (!exprs.isEmpty()) out.insert(st.info.name, exprs);
+    }
+    return out;
+}
+
+void DDSCore::advertiseContentFilters() {
+    if (discoveryManager) discoveryManager->setContentFilters(advertisedContentFilters());
 }
 
 
 qint64 DDSCore::publishInternal(const QString& topic, const QJsonObject& payload, const QString& qos) {
-    MessageEnvelope m; m.topic=topic; m.payload=payload; m.qos=qos; m.publisher_id=node_id;
+    return publishInternal(TopicRegistry::instance().intern(topic), payload, qos);
+}
+
+qint64 DDSCore::publishInternal(TopicId topic, const QJsonObject& payload, const QString& qos) {
+    TopicState& st = state(topic);
+    MessageEnvelope m; m.topic=st.info.name; m.payload=payload; m.qos=qos; m.publisher_id=node_id;
     m.message_id = next_msg_id++; m.timestamp = QDateTime::currentSecsSinceEpoch();
-    const bool reliable = isReliable(qos);
-    sendMessage(m, reliable); lastMsg.insert(topic, payload);
+    m.incarnation = incarnation;
+    const bool nack = isNackReliable(qos);
+    m.seq = nack ? ++st.nextNackSeq : isReliable(qos) ? ++st.nextSeq : ++st.nextBestEffortSeq;
+    if (nack) {
+        NackHistory& h = nackHistory[topic];
+        if (h.ring.isEmpty()) h.ring.resize(ConfigManager::ref().qos_cfg.nack.history_depth);
+        h.ring[int(m.seq % quint64(h.ring.size()))] = m;
+        h.last = m.seq;
+        h.heartbeatsLeft = kHeartbeatsAfterWrite;
+        if (!heartbeatTimer.isActive()) heartbeatTimer.start(ConfigManager::ref().qos_cfg.nack.heartbeat_ms);
+    }
+    const bool reliable = isReliable(qos) || nack;
+    sendMessage(m, st, reliable); st.lastMsg = LastSample{payload, qos, m.message_id}; st.lastUndelivered.reset();
     if (ConfigManager::ref().qos_cfg.retain_last) {
-        last_by_topic_[topic] = m;
+        st.retained = m;
+    }
+    // Subscribers in this core get the publisher's object itself: no encode, no
+    // socket. Our own datagram is dropped on receive, so this is their only copy.
+    if (ConfigManager::ref().transport.intra_process && !st.subs.isEmpty()) {
+        deliverToLocal(st, payload, qos, m.message_id);
     }
     return m.message_id;
 }
 
-void DDSCore::sendMessage(const MessageEnvelope& m, bool reliable) {
-    const auto& cfg = ConfigManager::ref();
-    const QString ourFormat = cfg.serialization.format;
-    const QStringList ourPrefs = cfg.serialization.supported;
+// --- routing index ---
+const QVector<DDSCore::PeerRoute>& DDSCore::routesFor(TopicId topic) const {
+    static const QVector<PeerRoute> none;
+    const TopicState* st = findState(topic);
+    return st ? st->routes : none;
+}
 
-    QStringList destPeers;
-    if (discoveryManager) {
-        for (const auto& peer : discoveryManager->list_peers()) {
-            if (peer.topics.contains(m.topic)) destPeers << peer.node_id;
-        }
+const DDSCore::PeerRoute* DDSCore::routeTo(const QString& pid) const {
+    const auto it = routePeers.constFind(pid);
+    return it == routePeers.constEnd() ? nullptr : &it->route;
+}
+
+void DDSCore::unroute(const QString& pid) {
+    const auto it = routePeers.constFind(pid);
+    if (it == routePeers.constEnd()) return;
+    const auto theirs = [&](const PeerRoute& r) { return r.peer == pid; };
+    if (it->filters.isEmpty()) {
+        for (TopicId topic : it->topics) state(topic).routes.removeIf(theirs);
     } else {
-        // Fallback to old peers map
-        for (auto it = peers.begin(); it != peers.end(); ++it) {
-            const QString pid = it.key();
-            const QJsonObject o = it.value();
-            bool has = false;
-            const QJsonValue topicsVal = o.value("topics");
-            if (topicsVal.isArray()) {
-                const QJsonArray arr = topicsVal.toArray();
-                for (const QJsonValue& v : arr) {
-                    if (v.isString() && v.toString() == m.topic) { has = true; break; }
-                }
-            }
-            if (has) destPeers << pid;
-        }
+        // Filter routes may sit on any topic
+        for (const QString& f : it->filters) peerFilters.remove(f, pid);
+        for (TopicState& st : topicStates) st.routes.removeIf(theirs);
     }
+    routePeers.erase(it);
+}
+
+void DDSCore::setDiscoveryManager(DiscoveryManager* dm) {
+    discoveryManager = dm;
+    if (!dm) return;
+    connect(dm, &DiscoveryManager::peerUpdated, this, &DDSCore::updatePeers, Qt::UniqueConnection);
+    connect(dm, &DiscoveryManager::peerExpired, this, &DDSCore::removePeer, Qt::UniqueConnection);
+    advertiseContentFilters();
+}
+
+Pending DDSCore::reliablePending(const QByteArray& packet, const QHostAddress& to, quint16 port, qint64 msgId,
+                                 const QString& pid, const TopicState& topic, quint64 seq) const {
+    const auto& rel = ConfigManager::ref().qos_cfg.reliable;
+    Pending p;
+    p.packet = packet;
+    p.retries_left = rel.max_retries;
+    p.deadline_ms = QDateTime::currentMSecsSinceEpoch() + rel.ack_timeout_ms;
+    p.base_timeout_ms = rel.ack_timeout_ms;
+    p.exponential_backoff = rel.exponential_backoff;
+    p.to = to;
+    p.port = port;
+    p.msg_id = msgId;
+    p.receiver_id = pid;
+    p.topic = topic.info.name;
+    p.topic_id = topic.id;
+    p.seq = seq;
+    return p;
+}
+
+// Heartbeat telling one reader where our reliable stream starts for it: every
+// seq below the oldest one it still owes us an ACK for is retired or given up.
+// Until it hears this, the reader acknowledges nothing, so a lost first sample
+// is never covered by a SACK for the ones behind it.
+OutDatagram DDSCore::streamStart(const QString& pid, TopicId topic, const QString& name, quint64 seq,
+                                 const QString& fmt, const QHostAddress& to, quint16 port) const {
+    SackPacket hb;
+    hb.topic = name;
+    hb.publisher_id = node_id;
+    hb.receiver_id = pid;
+    hb.qos = QStringLiteral("reliable");
+    hb.incarnation = incarnation;
+    hb.first_seq = ack ? ack->oldestSeq(pid, topic) : 0;
+    if (!hb.first_seq || hb.first_seq > seq) hb.first_seq = seq;
+    hb.cum_seq = seq;
+    hb.timestamp = QDateTime::currentSecsSinceEpoch();
+    qCDebug(LogQoS) << "[HB][START] topic=" << hb.topic << " to=" << pid << " first=" << hb.first_seq;
+    return OutDatagram{Serializer::encodeHeartbeat(hb, fmt), to, port};
+}
+
+void DDSCore::sendMessage(const MessageEnvelope& m, TopicState& st, bool reliable, const QString& onlyPeer) {
+    const auto& cfg = ConfigManager::ref();
+    const QString ourFormat = cfg.serialization.format;
+    const bool nack = isNackReliable(m.qos);
+
+    // Shared copy of this topic's destinations; resolved on discovery, not here
+    const QVector<PeerRoute> destPeers = st.routes;
 
     if (reliable) {
         if (destPeers.isEmpty()) {
-            qCWarning(LogNet) << "[ROUTE][MISS] no peers for reliable topic=" << m.topic << "; dropping mid=" << m.message_id;
+            if (!cfg.transport.intra_process || st.subs.isEmpty()) {
+                qCWarning(LogNet) << "[ROUTE][MISS] no peers for reliable topic=" << m.topic << "; dropping mid=" << m.message_id;
+            }
             return;
         }
-        for (const auto& pid : destPeers) {
-            QString negotiatedFormat = peerFormats.value(pid, "");
-            if (negotiatedFormat.isEmpty()) {
-                // Negotiate format with peer
-                QStringList peerPrefs;
-                if (discoveryManager && discoveryManager->has_peer(pid)) {
-                    peerPrefs = discoveryManager->serialization_formats_for(pid);
-                } else {
-                    const QJsonObject o = peers.value(pid);
-                    const QJsonValue serVal = o.value("serialization");
-                    if (serVal.isArray()) {
-                        const QJsonArray arr = serVal.toArray();
-                        for (const QJsonValue& v : arr) {
-                            if (v.isString()) peerPrefs << v.toString();
-                        }
-                    }
-                }
-                negotiatedFormat = Serializer::negotiateFormat(ourPrefs, peerPrefs);
-                if (negotiatedFormat.isEmpty()) {
-                    if (cfg.serialization.allow_json_fallback) {
-                        negotiatedFormat = "json";
-                        qCWarning(LogNet) << "[NEGOTIATE][FALLBACK] no mutual format with " << pid << ", using json";
-                    } else {
-                        qCritical(LogNet) << "[NEGOTIATE][FAIL] no mutual format with " << pid << ", skipping";
-                        continue;
-                    }
-                }
-                peerFormats[pid] = negotiatedFormat;
-                qCInfo(LogNet) << "[NEGOTIATE] chosen=" << negotiatedFormat << " local=" << ourPrefs << " remote=" << peerPrefs;
-            }
-
-            // Get peer address
-            QString ip = "127.0.0.1"; // Assume localhost for now
-            quint16 dp = 0;
-            if (discoveryManager && discoveryManager->has_peer(pid)) {
-                PeerInfo peerInfo = discoveryManager->get_peer(pid);
-                dp = peerInfo.udp_port;
-            } else {
-                const QJsonObject o = peers.value(pid);
-                dp = static_cast<quint16>(o.value("data_port").toInt(net->boundPort()));
-            }
-            if (dp == 0) continue;
+        // One encode per negotiated format (and per receiver topic id on bin);
+        // the QByteArray is implicitly shared by every peer send and every
+        // Pending entry using that encoding.
+        QHash<QPair<QString, quint64>, QByteArray> encodedByFormat;
+        // With multicast on, the first peer of each (format, data port) triggers
+        // the group send; per-peer Pending entries still retransmit by unicast.
+        const QHostAddress mcast = multicastGroupFor(m.topic);
+        QSet<QPair<QString, quint16>> multicastSends;
+        QVector<OutDatagram> fanOut; // unicast copies, handed to the transport in one batch
+        QVector<int> started;        // routes whose reader now knows where our stream starts
+        for (const PeerRoute& route : destPeers) {
+            const QString& pid = route.peer;
+            const QString& negotiatedFormat = route.format;
+            const QHostAddress& addr = route.addr;
+            const quint16 dp = route.port;
+            const QString ip = addr.toString();
 
-            qCInfo(LogNet) << "[ROUTE] topic=" << m.topic << " peer=" << pid << " -> udp=" << ip << ":" << dp;
+            qCDebug(LogNet) << "[ROUTE] topic=" << m.topic << " peer=" << pid << " -> udp=" << ip << ":" << dp;
         
             try {
-                // Encode packet in negotiated format
-                QByteArray packet = Serializer::encodeEnvelope(m, negotiatedFormat);
+                // Encode packet in negotiated format (once per format); peers without
+                // reliable_nack get a seq-less "reliable" copy they acknowledge per message.
+                const bool ackFallback = nack && !route.nack;
+                const bool toGroup = !mcast.isNull() && !ackFallback && onlyPeer.isEmpty();
+                // Unicast bin copies name the topic by the receiver's own id; the
+                // group copy has many receivers, so it keeps the name.
+                const bool byId = !toGroup && negotiatedFormat == QLatin1String("bin") && route.topicRef && route.topicEpoch;
+                // A unicast peer whose advertised content filters all reject the
+                // sample gets only its seq, so the stream stays gap-free for SACKs
+                // and NACKs; a seq-less copy is not sent at all.
+                const bool filtered = (!onlyPeer.isEmpty() && pid != onlyPeer) || (!toGroup && route.where &&
+                    std::none_of(route.where->cbegin(), route.where->cend(),
+                                 [&](const ContentFilter& f) { return f.matches(m.payload); }));
+                if (filtered && ackFallback) {
+                    qCDebug(LogNet) << "[ROUTE][FILTERED] mid=" << m.message_id << " peer=" << pid << " skipped";
+                    continue;
+                }
+                const QPair<QString, quint64> encKey(negotiatedFormat,
+                    (quint64(filtered) << 63) |
+                    (byId ? (quint64(route.topicEpoch) << 33) | (quint64(route.topicRef) << 1) : 0) | quint64(ackFallback));
+                auto enc = encodedByFormat.constFind(encKey);
+                if (enc == encodedByFormat.constEnd()) {
+                    MessageEnvelope wire = m;
+                    if (ackFallback) { wire.qos = QStringLiteral("reliable"); wire.seq = 0; }
+                    if (byId) { wire.topic_ref = route.topicRef; wire.topic_epoch = route.topicEpoch; }
+                    if (filtered) { wire.payload = QJsonObject(); wire.filtered = true; }
+                    enc = encodedByFormat.insert(encKey, Serializer::encodeEnvelope(wire, negotiatedFormat));
+                }
+                const QByteArray packet = *enc;
                 qCDebug(LogNet) << "[SEND][ENVELOPE] size=" << packet.size() << " fmt=" << negotiatedFormat << " topic=" << m.topic << " mid=" << m.message_id << " peers=" << destPeers.size();
         
-                int bytesSent = net->send(packet, QHostAddress(ip), dp);
-                qCDebug(LogNet) << "[SEND][UNICAST] mid=" << m.message_id << " -> " << ip << ":" << dp << " bytes=" << bytesSent;
-        
-                if (ack) {
-                    auto& cfg = ConfigManager::ref();
-                    Pending p;
-                    p.packet = packet;
-                    p.retries_left = cfg.qos_cfg.reliable.max_retries;
-                    p.deadline_ms = QDateTime::currentMSecsSinceEpoch() + cfg.qos_cfg.reliable.ack_timeout_ms;
-                    p.base_timeout_ms = cfg.qos_cfg.reliable.ack_timeout_ms;
-                    p.exponential_backoff = cfg.qos_cfg.reliable.exponential_backoff;
-                    p.to = QHostAddress(ip);
-                    p.port = dp;
-                    p.msg_id = m.message_id;
-                    p.receiver_id = pid;
-                    ack->track(p);
-                    qCDebug(LogQoS) << "[TRACK]" << m.message_id << "to" << pid;
+                // The peer's send window decides whether the unicast copy goes out
+                // now or waits in AckManager until ACKs open it (sendQueued). The
+                // group copy has already reached a group peer, so it only counts
+                // against the window: nothing is queued to be sent again.
+                bool admitted = true;
+                if (ack && (!nack || ackFallback)) {
+                    const Pending p = reliablePending(packet, addr, dp, m.message_id, pid, st, ackFallback ? 0 : m.seq);
+                    if (toGroup) ack->track(p);
+                    else admitted = ack->submit(p);
+                    qCDebug(LogQoS) << (admitted ? "[TRACK]" : "[QUEUE]") << m.message_id << "to" << pid;
+                }
+
+                if (toGroup) {
+                    // One datagram per wire format and data port reaches every group
+                    // member; peers that see a copy in a second format drop it as a duplicate.
+                    const QPair<QString, quint16> groupSend(negotiatedFormat, dp);
+                    if (!multicastSends.contains(groupSend)) {
+                        multicastSends.insert(groupSend);
+                        int bytesSent = net->send(packet, mcast, dp);
+                        qCDebug(LogNet) << "[SEND][MCAST] mid=" << m.message_id << " -> " << mcast.toString() << ":" << dp << " fmt=" << negotiatedFormat << " bytes=" << bytesSent;
+                    }
+                } else if (admitted) {
+                    fanOut.append(OutDatagram{packet, addr, dp});
+                    qCDebug(LogNet) << "[SEND][UNICAST] mid=" << m.message_id << " -> " << ip << ":" << dp << " bytes=" << packet.size();
+                }
+                // After the sample: a restarted publisher's new incarnation reaches
+                // the reader first, so it resets the stream before opening it.
+                if (!nack && m.seq && !route.started) {
+                    fanOut.append(streamStart(pid, st.id, m.topic, m.seq, negotiatedFormat, addr, dp));
+                    started.append(int(&route - destPeers.constData()));
                 }
             } catch (const std::exception& e) {
                 qCritical(LogNet) << "[SEND][EXC] mid=" << m.message_id << " to " << pid << " what=" << e.what();
@@ -194,61 +514,149 @@ void DDSCore::sendMessage(const MessageEnvelope& m, bool reliable) {
                 qCritical(LogNet) << "[SEND][EXC] mid=" << m.message_id << " to " << pid << " unknown";
             }
         }
+        for (int i : std::as_const(started)) {
+            if (i < st.routes.size() && st.routes[i].peer == destPeers[i].peer) st.routes[i].started = true;
+        }
+        if (!fanOut.isEmpty()) {
+            const int sent = net->sendBatch(fanOut);
+            if (sent != fanOut.size()) {
+                qCWarning(LogNet) << "[SEND][BATCH] mid=" << m.message_id << " sent" << sent << "of" << fanOut.size();
+            }
+        }
         qCDebug(LogNet) << "[SEND][DONE] mid=" << m.message_id << " sent to " << destPeers.size() << " peers";
     } else {
-        // best-effort: broadcast (use our preferred format)
+        // best-effort: topic group when multicast is on, broadcast otherwise (use our preferred format)
         QByteArray packet = Serializer::encodeEnvelope(m, ourFormat);
-        net->send(packet, QHostAddress::Broadcast, ConfigManager::ref().transport.udp.port);
-        qCDebug(LogNet) << "[SEND][BCAST]" << m.topic << "mid=" << m.message_id << "(fmt=" << ourFormat << ")";
+        const QHostAddress group = multicastGroupFor(m.topic);
+        if (!group.isNull()) {
+            for (quint16 port : groupPorts(destPeers)) net->send(packet, group, port);
+            qCDebug(LogNet) << "[SEND][MCAST]" << m.topic << "mid=" << m.message_id << "group=" << group.toString() << "(fmt=" << ourFormat << ")";
+        } else {
+            net->send(packet, QHostAddress::Broadcast, ConfigManager::ref().transport.udp.port);
+            qCDebug(LogNet) << "[SEND][BCAST]" << m.topic << "mid=" << m.message_id << "(fmt=" << ourFormat << ")";
+        }
     }
 }
 
 // --- deliverToLocal ---
 void DDSCore::deliverToLocal(const QString& topic, const QJsonObject& payload, const QString& qos, qint64 msg_id) {
-    QJsonObject enriched = payload;
-    enriched["topic"] = topic;
-    enriched["qos"] = qos;
-    enriched["message_id"] = msg_id;
-    if (subs.contains(topic)) {
-        auto cb = subs.value(topic);
-        if (cb) cb(enriched);
+    deliverToLocal(state(TopicRegistry::instance().intern(topic)), payload, qos, msg_id);
+}
+
+void DDSCore::deliverToLocal(TopicState& st, const QJsonObject& payload, const QString& qos, qint64 msg_id) {
+    // Every subscriber gets the same decoded object. Iterate a shared copy, so a
+    // callback may (un)subscribe without invalidating the loop; handles dropped
+    // mid-dispatch are skipped. `st` is not touched once callbacks run: one that
+    // creates a new topic may move topicStates.
+    st.lastMsg = LastSample{payload, qos, msg_id};
+    const QString topic = st.info.name;
+    const QVector<LocalSubscription> list = st.subs;
+    // Content filters see the payload as published; the enriched copy is only
+    // built once some subscriber takes the sample.
+    std::optional<QJsonObject> enriched;
+    for (const LocalSubscription& l : list) {
+        if (!l.cb || !subscriptionTopics.contains(l.id)) continue;
+        if (l.where && !l.where->matches(payload)) continue;
+        if (!enriched) {
+            enriched = payload;
+            (*enriched)["topic"] = topic;
+            (*enriched)["qos"] = qos;
+            (*enriched)["message_id"] = msg_id;
+        }
+        l.cb(*enriched);
     }
-    lastMsg.insert(topic, enriched);
 }
 
 
 void DDSCore::onDatagram(const QByteArray& bytes, QHostAddress from, quint16 port) {
     qCDebug(LogNet) << "[UDP-IN] src=" << from.toString() << ":" << port << " len=" << bytes.size();
-    PacketType t = PacketType::Unknown; auto parsed = Serializer::decode(bytes, &t); if (!parsed) return;
-    auto o = *parsed;
-    if (t == PacketType::Data) {
-        const auto topic = o.value("topic").toString();
-        const auto publisher = o.value("publisher_id").toString(); if (publisher == node_id) return;
-        const qint64 mid = o.value("message_id").toVariant().toLongLong();
-        // Per-topic LRU/set for deduplication
-        QSet<qint64>& topicSet = perTopicDedup[topic];
-        if (topicSet.contains(mid)) {
-            qCDebug(LogNet) << "[DUP][PER-TOPIC] skipping" << topic << mid;
-            return;
+    auto parsed = Serializer::decodeEnvelopeView(bytes); if (!parsed) return;
+    const EnvelopeView& v = *parsed;
+    if (v.type == PacketType::Data) {
+        const QString& topic = v.topic;
+        const QString& publisher = v.publisher_id; if (publisher == node_id) return;
+        const qint64 mid = v.message_id;
+        // Only topics we know, or a local wildcard subscription matches, get any
+        // state; anything else on the network is dropped without interning it.
+        TopicId tid = v.topic_id ? v.topic_id : TopicRegistry::instance().find(topic);
+        if (!findState(tid)) {
+            if (localFilters.match(topic).isEmpty()) {
+                qCDebug(LogNet) << "[RX][UNWANTED] topic=" << topic << " from=" << publisher;
+                return;
+            }
+            if (!tid) tid = TopicRegistry::instance().intern(topic);
         }
-        topicSet.insert(mid);
-        // Bounded to dedup_capacity
-        if (topicSet.size() > ConfigManager::ref().qos_cfg.dedup_capacity) {
-            // Remove oldest (not strictly LRU, but sufficient for bounded set)
-            auto it = topicSet.begin();
-            topicSet.erase(it);
+        const quint32 pub = internPublisher(publisher);
+        checkIncarnation(pub, v.incarnation);
+        const StreamKey streamId = streamKey(pub, tid);
+        if (v.seq && !isReliable(v.qos) && !isNackReliable(v.qos)) {
+            if (!bestEffortStreams[streamId].accept(v.seq)) {
+                qCDebug(LogNet) << "[DUP][SEQ] skipping" << publisher << topic << v.seq;
+                return;
+            }
+        } else if (v.seq) {
+            const bool nackStream = isNackReliable(v.qos);
+            AckStream& st = (nackStream ? nackStreams : ackStreams)[streamId];
+            bool fresh;
+            if (nackStream) {
+                // A reliable_nack reader joins at the first sample it sees; earlier
+                // history is not requested
+                if (st.window.highest() == 0) st.window.skipTo(v.seq);
+                fresh = st.window.accept(v.seq);
+            } else if (st.opened) {
+                fresh = st.window.accept(v.seq);
+            } else {
+                // Until the publisher says where the stream starts, a missing seq
+                // may be a lost sample or one that was never ours: hold the ACK.
+                // Past the cap the oldest is forgotten; a retransmit of it would
+                // be delivered twice, but nothing is acknowledged unseen.
+                fresh = !st.early.contains(v.seq);
+                if (fresh) {
+                    if (st.early.size() >= SeqWindow::kWidth) st.early.removeFirst();
+                    st.early.append(v.seq);
+                }
+            }
+            st.publisher = publisher;
+            st.topic = topic;
+            st.to = from;
+            st.port = port;
+            st.format = formatName(v.format);
+            if (!nackStream) {
+                // Duplicates are re-acknowledged too: the previous ACK may have been lost
+                if (st.opened) {
+                    dirtyAckStreams.insert(streamId);
+                    if (!ackFlushTimer.isActive()) ackFlushTimer.start(ConfigManager::ref().qos_cfg.reliable.ack_delay_ms);
+                }
+            } else if (st.window.missingBits(st.announced)) {
+                dirtyNackStreams.insert(streamId);
+                if (!nackFlushTimer.isActive()) nackFlushTimer.start(ConfigManager::ref().qos_cfg.nack.nack_delay_ms);
+            }
+            if (!fresh) {
+                qCDebug(LogNet) << "[DUP][SEQ] skipping" << publisher << topic << v.seq;
+                return;
+            }
+        } else if (mid > 0 && !remotePublishers[pub].mids.accept(quint64(mid))) {
+            // No stream seq (older publishers, per-message-ACK fallback copies):
+            // message ids rise per publisher, so the same window works over them
+            qCDebug(LogNet) << "[DUP][MID] skipping" << publisher << topic << mid;
+            return;
         }
-        const QString key = publisher + ":" + topic + ":" + QString::number(mid);
-        if (seenMessages.contains(key)) {
-            qCDebug(LogNet) << "[DUP] skipping" << key;
+        if (v.filtered) {
+            // The publisher applied our advertised content filter; only the seq came
+            qCDebug(LogNet) << "[RX][FILTERED]" << publisher << topic << v.seq;
             return;
         }
-        seenMessages.insert(key);
-        const auto qos = o.value("qos").toString();
-        deliverToLocal(topic, o.value("payload").toObject(), qos, mid);
-        if (isReliable(qos)) {
-            const qint64 mid = o.value("message_id").toVariant().toLongLong();
-
+        const QString& qos = v.qos;
+        // Only materialise the payload when someone local wants it; otherwise keep
+        // the encoded packet around for a late subscriber.
+        TopicState& ts = state(tid);
+        if (!ts.subs.isEmpty()) {
+            deliverToLocal(ts, v.payload(), qos, mid);
+        } else {
+            ts.lastUndelivered = v;
+        }
+        if (isReliable(qos) && v.seq == 0) {
+            // Publisher without stream sequence numbers: acknowledge this message alone.
             // Find the peer and negotiate format for ACK
             QString ackFormat = "json"; // default fallback
             for (auto it = peers.begin(); it != peers.end(); ++it) {
@@ -259,8 +667,8 @@ void DDSCore::onDatagram(const QByteArray& bytes, QHostAddress from, quint16 por
                     const QJsonValue serVal = peerObj.value("serialization");
                     if (serVal.isArray()) {
                         const QJsonArray arr = serVal.toArray();
-                        for (const QJsonValue& v : arr) {
-                            if (v.isString()) peerPrefs << v.toString();
+                        for (const QJsonValue& fv : arr) {
+                            if (fv.isString()) peerPrefs << fv.toString();
                         }
                     }
                     ackFormat = Serializer::negotiateFormat(ConfigManager::ref().serialization.supported, peerPrefs);
@@ -276,23 +684,456 @@ void DDSCore::onDatagram(const QByteArray& bytes, QHostAddress from, quint16 por
             net->send(ackPkt, from, port);
             qCDebug(LogQoS) << "[ACK][TX]" << mid << "->" << from.toString() << ":" << port << "(fmt=" << ackFormat << ")";
         }
-    } else if (t == PacketType::Ack) {
+    } else if (v.type == PacketType::Ack) {
         if (ack) {
-            const qint64 mid = o.value("message_id").toVariant().toLongLong();
-            const QString receiverId = o.value("receiver_node_id").toString();
+            const qint64 mid = v.message_id;
+            const QString& receiverId = v.receiver_id;
             qCDebug(LogQoS) << "[ACK][IN] mid=" << mid << " fmt=json bytes=" << bytes.size();
             ack->ackReceived(mid, receiverId);
             qCDebug(LogQoS) << "[ACK][RX]" << mid << "from" << receiverId;
         }
+    } else if (v.type == PacketType::Sack) {
+        if (ack && v.publisher_id == node_id) {
+            const TopicId tid = TopicRegistry::instance().find(v.topic);
+            const QVector<qint64> retired = ack->ackRange(v.receiver_id, tid, v.cum_seq, v.sack_bits);
+            qCDebug(LogQoS) << "[SACK][RX] topic=" << v.topic << " from=" << v.receiver_id << " cum=" << v.cum_seq
+                            << " bits=" << Qt::hex << v.sack_bits << Qt::dec << " retired=" << retired.size();
+            for (qint64 mid : retired) qCDebug(LogQoS) << "[ACK][RX]" << mid << "from" << v.receiver_id;
+        }
+    } else if (v.type == PacketType::Nack) {
+        if (v.publisher_id == node_id) repairFromHistory(v, from, port);
+    } else if (v.type == PacketType::Heartbeat) {
+        const bool ackMode = isReliable(v.qos);
+        if (v.publisher_id == node_id || (ackMode && v.receiver_id != node_id)) return;
+        const TopicId tid = TopicRegistry::instance().find(v.topic);
+        if (!tid) return;
+        // Only an ACK-mode start opens a stream; a reliable_nack heartbeat is
+        // for streams we already read, so it never interns its publisher
+        const auto known = publisherIndex.constFind(v.publisher_id);
+        if (!ackMode && known == publisherIndex.constEnd()) return;
+        const quint32 pub = ackMode ? internPublisher(v.publisher_id) : *known;
+        checkIncarnation(pub, v.incarnation);
+        if (ackMode) {
+            openAckStream(v, streamKey(pub, tid), from, port);
+            return;
+        }
+        const auto it = nackStreams.find(streamKey(pub, tid));
+        if (it == nackStreams.end()) return;
+        AckStream& st = *it;
+        st.window.skipTo(v.first_seq);
+        st.announced = v.cum_seq;
+        st.to = from;
+        st.port = port;
+        qCDebug(LogQoS) << "[HB][RX] topic=" << v.topic << " from=" << v.publisher_id << " first=" << v.first_seq
+                        << " last=" << v.cum_seq << " have=" << st.window.cumulative();
+        if (st.window.missingBits(st.announced)) {
+            dirtyNackStreams.insert(it.key());
+            if (!nackFlushTimer.isActive()) nackFlushTimer.start(ConfigManager::ref().qos_cfg.nack.nack_delay_ms);
+        }
+    }
+}
+
+// The publisher told us where its reliable stream starts for us: everything
+// below first_seq is acknowledged or abandoned on its side.
+void DDSCore::openAckStream(const EnvelopeView& hb, StreamKey streamId, const QHostAddress& from, quint16 port) {
+    AckStream& st = ackStreams[streamId];
+    st.window.skipTo(hb.first_seq);
+    if (!st.opened) {
+        for (quint64 seq : std::as_const(st.early)) st.window.accept(seq);
+        st.early.clear();
+        st.opened = true;
+    }
+    st.publisher = hb.publisher_id;
+    st.topic = hb.topic;
+    st.to = from;
+    st.port = port;
+    st.format = formatName(hb.format);
+    qCDebug(LogQoS) << "[HB][RX] topic=" << hb.topic << " from=" << hb.publisher_id << " starts=" << hb.first_seq
+                    << " have=" << st.window.cumulative();
+    dirtyAckStreams.insert(streamId);
+    if (!ackFlushTimer.isActive()) ackFlushTimer.start(ConfigManager::ref().qos_cfg.reliable.ack_delay_ms);
+}
+
+quint32 DDSCore::internPublisher(const QString& publisher) {
+    const auto it = publisherIndex.constFind(publisher);
+    if (it != publisherIndex.constEnd()) return *it;
+    quint32 pub;
+    if (!freePublishers.isEmpty()) {
+        pub = freePublishers.takeLast();
+    } else {
+        pub = quint32(remotePublishers.size());
+        remotePublishers.append(RemotePublisher());
+    }
+    publisherIndex.insert(publisher, pub);
+    return pub;
+}
+
+void DDSCore::checkIncarnation(quint32 publisher, quint32 incarnation) {
+    if (!incarnation) return;
+    quint32& known = remotePublishers[publisher].incarnation;
+    if (known == incarnation) return;
+    if (known) {
+        forgetPublisher(publisher);
+        qCInfo(LogQoS) << "[RESTART] publisher=" << publisherIndex.key(publisher) << " restarted; stream windows reset";
+    }
+    known = incarnation;
+}
+
+// The publisher restarted: its seqs and message ids begin again at 1, so
+// every window we hold for it would take the new samples for duplicates.
+void DDSCore::forgetPublisher(quint32 publisher) {
+    const auto theirs = [&](StreamKey k) { return quint32(k >> 32) == publisher; };
+    for (auto* streams : {&ackStreams, &nackStreams}) {
+        for (auto it = streams->begin(); it != streams->end();) it = theirs(it.key()) ? streams->erase(it) : std::next(it);
+    }
+    for (auto it = bestEffortStreams.begin(); it != bestEffortStreams.end();) {
+        it = theirs(it.key()) ? bestEffortStreams.erase(it) : std::next(it);
+    }
+    dirtyAckStreams.removeIf(theirs);
+    dirtyNackStreams.removeIf(theirs);
+    remotePublishers[publisher].mids = SeqWindow();
+}
+
+// The peer expired: its windows go, and its slot is reused by the next new publisher
+void DDSCore::releasePublisher(const QString& publisher) {
+    const auto it = publisherIndex.constFind(publisher);
+    if (it == publisherIndex.constEnd()) return;
+    const quint32 pub = *it;
+    forgetPublisher(pub);
+    remotePublishers[pub] = RemotePublisher();
+    freePublishers.append(pub);
+    publisherIndex.erase(it);
+}
+
+void DDSCore::flushNacks() {
+    const qint64 ts = QDateTime::currentSecsSinceEpoch();
+    QVector<OutDatagram> out;
+    for (const StreamKey& id : std::as_const(dirtyNackStreams)) {
+        const AckStream& st = nackStreams[id];
+        SackPacket s;
+        s.sack_bits = st.window.missingBits(st.announced);
+        if (!s.sack_bits) continue; // repaired meanwhile
+        s.topic = st.topic;
+        s.publisher_id = st.publisher;
+        s.receiver_id = node_id;
+        s.cum_seq = st.window.cumulative();
+        s.timestamp = ts;
+        out.append(OutDatagram{Serializer::encodeNack(s, st.format), st.to, st.port});
+        qCDebug(LogQoS) << "[NACK][TX] topic=" << st.topic << " cum=" << s.cum_seq << " missing=" << Qt::hex << s.sack_bits
+                        << Qt::dec << " -> " << st.to.toString() << ":" << st.port;
+    }
+    dirtyNackStreams.clear();
+    if (!out.isEmpty()) net->sendBatch(out);
+}
+
+// Resends the NACKed samples we still hold, unicast to the reader in the
+// format it used. If any are gone, a heartbeat tells it where our history starts.
+void DDSCore::repairFromHistory(const EnvelopeView& nack, const QHostAddress& from, quint16 port) {
+    const auto h = nackHistory.constFind(TopicRegistry::instance().find(nack.topic));
+    if (h == nackHistory.constEnd()) return;
+    const QString fmt = formatName(nack.format);
+    QVector<OutDatagram> out;
+    bool lost = false;
+    for (int i = 0; i < 32; ++i) {
+        if (!((nack.sack_bits >> i) & 1u)) continue;
+        const quint64 seq = nack.cum_seq + 1 + quint64(i);
+        if (const MessageEnvelope* m = h->find(seq)) out.append(OutDatagram{Serializer::encodeEnvelope(*m, fmt), from, port});
+        else lost = true;
+    }
+    if (lost) {
+        SackPacket hb;
+        hb.topic = nack.topic;
+        hb.publisher_id = node_id;
+        hb.receiver_id = nack.receiver_id;
+        hb.first_seq = h->first();
+        hb.cum_seq = h->last;
+        hb.incarnation = incarnation;
+        hb.timestamp = QDateTime::currentSecsSinceEpoch();
+        out.append(OutDatagram{Serializer::encodeHeartbeat(hb, fmt), from, port});
+    }
+    qCDebug(LogQoS) << "[NACK][RX] topic=" << nack.topic << " from=" << nack.receiver_id << " cum=" << nack.cum_seq
+                    << " missing=" << Qt::hex << nack.sack_bits << Qt::dec << " repaired=" << (out.size() - (lost ? 1 : 0));
+    if (!out.isEmpty()) net->sendBatch(out);
+}
+
+void DDSCore::sendHeartbeats() {
+    const auto& cfg = ConfigManager::ref();
+    const qint64 ts = QDateTime::currentSecsSinceEpoch();
+    QVector<OutDatagram> out;
+    bool more = false;
+    for (auto it = nackHistory.begin(); it != nackHistory.end(); ++it) {
+        NackHistory& h = it.value();
+        if (h.heartbeatsLeft <= 0) continue;
+        more |= --h.heartbeatsLeft > 0;
+        SackPacket s;
+        s.topic = TopicRegistry::instance().name(it.key());
+        s.publisher_id = node_id;
+        s.first_seq = h.first();
+        s.cum_seq = h.last;
+        s.incarnation = incarnation;
+        s.timestamp = ts;
+        const QHostAddress group = multicastGroupFor(s.topic);
+        const QVector<PeerRoute>& routes = routesFor(it.key());
+        if (!group.isNull()) {
+            const QByteArray beat = Serializer::encodeHeartbeat(s, cfg.serialization.format);
+            for (quint16 port : groupPorts(routes)) out.append(OutDatagram{beat, group, port});
+            continue;
+        }
+        for (const PeerRoute& r : routes) {
+            if (!r.nack) continue;
+            s.receiver_id = r.peer;
+            out.append(OutDatagram{Serializer::encodeHeartbeat(s, r.format), r.addr, r.port});
+        }
+    }
+    if (!out.isEmpty()) net->sendBatch(out);
+    if (!more) heartbeatTimer.stop();
+}
+
+void DDSCore::flushAcks() {
+    const qint64 ts = QDateTime::currentSecsSinceEpoch();
+    QVector<OutDatagram> out;
+    out.reserve(dirtyAckStreams.size());
+    for (const StreamKey& id : std::as_const(dirtyAckStreams)) {
+        const AckStream& st = ackStreams[id];
+        SackPacket s;
+        s.topic = st.topic;
+        s.publisher_id = st.publisher;
+        s.receiver_id = node_id;
+        s.cum_seq = st.window.cumulative();
+        s.sack_bits = st.window.sackBits();
+        s.timestamp = ts;
+        out.append(OutDatagram{Serializer::encodeSack(s, st.format), st.to, st.port});
+        qCDebug(LogQoS) << "[SACK][TX] topic=" << st.topic << " cum=" << s.cum_seq << " -> " << st.to.toString() << ":" << st.port;
+    }
+    dirtyAckStreams.clear();
+    if (!out.isEmpty()) net->sendBatch(out);
+}
+
+void DDSCore::onDatagramBatch(const QVector<Datagram>& batch) {
+    for (const Datagram& d : batch) onDatagram(d.bytes, d.from, d.port);
+}
+
+static QStringList stringList(const QJsonValue& v) {
+    QStringList out;
+    for (const QJsonValue& e : v.toArray()) {
+        if (e.isString()) out << e.toString();
+    }
+    return out;
+}
+
+// Called for every announcement; the index is only rebuilt for this peer, and
+// only when its topics or route actually changed.
+void DDSCore::updatePeers(const QString& peerId, const QJsonObject& payload) {
+    peers.insert(peerId, payload);
+    const auto& cfg = ConfigManager::ref();
+
+    PeerEntry e;
+    TopicRegistry& registry = TopicRegistry::instance();
+    QStringList names = stringList(payload.value("topics"));
+    names.removeDuplicates();
+    for (const QString& topic : std::as_const(names)) {
+        if (!TopicTrie<QString>::isPattern(topic)) e.topics.append(registry.intern(topic));
+        else if (TopicTrie<QString>::isValidFilter(topic)) e.filters << topic;
+        else qCWarning(LogDisc) << "[ROUTE] peer=" << peerId << " advertises invalid filter" << topic;
+    }
+    const QJsonObject ids = payload.value("topic_ids").toObject();
+    for (auto it = ids.constBegin(); it != ids.constEnd(); ++it) {
+        const qint64 id = it.value().toVariant().toLongLong();
+        if (id > 0 && id <= 0xFFFFFFFFLL) e.topicIds.insert(it.key(), quint32(id));
+    }
+    e.whereSpec = payload.value("content_filters").toObject();
+    for (auto it = e.whereSpec.constBegin(); it != e.whereSpec.constEnd(); ++it) {
+        // One bad expression and the peer gets every sample of the topic
+        QVector<ContentFilter> compiled;
+        for (const QJsonValue& v : it.value().toArray()) {
+            QString error;
+            auto f = ContentFilter::compile(v.toString(), &error);
+            if (!f) {
+                qCWarning(LogNet) << "[ROUTE] peer=" << peerId << " topic=" << it.key() << " content filter ignored:" << error;
+                compiled.clear();
+                break;
+            }
+            compiled.append(std::move(*f));
+        }
+        if (!compiled.isEmpty()) e.where.insert(it.key(), std::make_shared<const QVector<ContentFilter>>(std::move(compiled)));
+    }
+    PeerRoute& r = e.route;
+    r.peer = peerId;
+    const QString hint = payload.value("transport_hint").toString();
+    r.addr = hint.isEmpty() ? QHostAddress(QHostAddress::LocalHost) : QHostAddress(hint);
+    r.port = static_cast<quint16>(payload.value("udp_port").toInt(payload.value("data_port").toInt(net->boundPort())));
+    r.nack = payload.value("qos_modes").toArray().contains(QJsonValue(QStringLiteral("reliable_nack")));
+    const QStringList peerPrefs = stringList(payload.value("serialization"));
+    r.format = Serializer::negotiateFormat(cfg.serialization.supported, peerPrefs);
+    // A restarted peer comes back with a new epoch and possibly different ids
+    r.topicEpoch = e.topicIds.isEmpty() ? 0 : quint32(payload.value("topic_epoch").toVariant().toLongLong());
+
+    const auto old = routePeers.constFind(peerId);
+    if (old != routePeers.constEnd() && old->topics == e.topics && old->filters == e.filters && old->route.addr == r.addr &&
+        old->route.port == r.port && old->route.nack == r.nack && old->route.format == r.format &&
+        old->route.topicEpoch == r.topicEpoch && old->topicIds == e.topicIds && old->whereSpec == e.whereSpec) {
+        return;
+    }
+    unroute(peerId);
+
+    if (r.format.isEmpty()) {
+        if (!cfg.serialization.allow_json_fallback) {
+            qCritical(LogNet) << "[NEGOTIATE][FAIL] no mutual format with " << peerId << ", not routing to it";
+            return;
+        }
+        r.format = QStringLiteral("json");
+        qCWarning(LogNet) << "[NEGOTIATE][FALLBACK] no mutual format with " << peerId << ", using json";
+    }
+    qCInfo(LogNet) << "[NEGOTIATE] peer=" << peerId << " chosen=" << r.format << " local=" << cfg.serialization.supported << " remote=" << peerPrefs;
+    if (r.port == 0) return;
+
+    for (TopicId topic : std::as_const(e.topics)) addRoute(state(topic), e);
+    // Matched through the same trie as our own filters; topics created later
+    // pick the route up in attachFilters()
+    for (const QString& f : std::as_const(e.filters)) {
+        peerFilters.insert(f, peerId);
+        for (TopicState& st : topicStates) {
+            if (!st.info.name.isEmpty() && TopicTrie<QString>::matches(f, st.info.name)) addRoute(st, e);
+        }
+    }
+    qCDebug(LogNet) << "[ROUTE][UPDATE] peer=" << peerId << " -> " << r.addr.toString() << ":" << r.port << " topics=" << e.topics.size() << " filters=" << e.filters.size();
+    routePeers.insert(peerId, e);
+}
+
+void DDSCore::removePeer(const QString& peerId) {
+    unroute(peerId);
+    releasePublisher(peerId);
+    if (ack) ack->releaseReceiver(peerId);
+    peers.remove(peerId);
+    qCDebug(LogNet) << "[ROUTE][EXPIRE] peer=" << peerId;
+}
+
+QStringList DDSCore::advertisedTopics() const {
+    QStringList out;
+    for (const TopicState& st : topicStates) {
+        if (st.declared) out << st.info.name;
+    }
+    for (const FilterSubscription& f : filterSubs) out << f.filter;
+    out.removeDuplicates();
+    return out;
+}
+
+void DDSCore::resendPackets(const QVector<Pending>& due) {
+    QVector<OutDatagram> out;
+    out.reserve(due.size());
+    // A reader that restarted, or lost our stream start, acknowledges nothing
+    // until it hears where the stream starts; repeat that after the samples.
+    QHash<QPair<QString, TopicId>, const Pending*> streams;
+    for (const Pending& p : due) {
+        qCDebug(LogQoS) << "[RESEND] mid=" << p.msg_id << " to=" << p.to.toString() << ":" << p.port << " attempt=" << p.attempt << " size=" << p.packet.size();
+        out.append(OutDatagram{p.packet, p.to, p.port});
+        if (p.seq) {
+            const Pending*& newest = streams[qMakePair(p.receiver_id, p.topic_id)];
+            if (!newest || newest->seq < p.seq) newest = &p;
+        }
+    }
+    for (const Pending* p : std::as_const(streams)) {
+        const PeerRoute* r = routeTo(p->receiver_id);
+        out.append(streamStart(p->receiver_id, p->topic_id, p->topic, p->seq, r ? r->format : QStringLiteral("json"), p->to, p->port));
+    }
+    net->sendBatch(out);
+}
+
+void DDSCore::sendQueued(const QVector<Pending>& ready) {
+    QVector<OutDatagram> out;
+    out.reserve(ready.size());
+    for (const Pending& p : ready) {
+        qCDebug(LogQoS) << "[SEND][DEQUEUE] mid=" << p.msg_id << " to=" << p.to.toString() << ":" << p.port;
+        out.append(OutDatagram{p.packet, p.to, p.port});
+    }
+    net->sendBatch(out);
+}
+
+bool DDSCore::isBackpressured(TopicId topic) const {
+    if (!ack || ack->queuedCount() == 0) return false;
+    for (const PeerRoute& r : routesFor(topic)) {
+        if (ack->queuedFor(r.peer) > 0) return true;
     }
+    return false;
 }
 
-void DDSCore::updatePeers(const QString& peerId, const QJsonObject& payload) { peers.insert(peerId, payload); }
-QStringList DDSCore::advertisedTopics() const { return topics.keys(); }
+// --- dead-letter replay ---
+int DDSCore::replayDeadLetters(int perSecond) {
+    if (!ack) return 0;
+    QVector<DeadLetterRecord> letters;
+    for (const DeadLetter& d : ack->deadLetters()) {
+        letters.append(DeadLetterRecord{d.failed_at_ms, d.msg_id, d.receiver_id, 0, QString(), d.packet});
+    }
+    return queueReplay(letters, perSecond);
+}
+
+int DDSCore::replayDeadLetters(const QString& path, int perSecond) {
+    if (!ack) return 0;
+    ack->flushDeadLetters(); // our own writer may still hold some
+    // Start where the last replay of this log stopped; re-dead-lettered
+    // replays are appended past that point and come up on the next run.
+    qint64 end = 0;
+    QVector<DeadLetterRecord> letters = DeadLetterWriter::readAll(path, DeadLetterWriter::replayCursor(path), &end);
+    DeadLetterWriter::setReplayCursor(path, end);
+    const auto noPacket = std::remove_if(letters.begin(), letters.end(),
+                                         [](const DeadLetterRecord& r) { return r.packet.isEmpty(); });
+    if (const int missing = int(letters.end() - noPacket)) {
+        qCWarning(LogQoS) << "[REPLAY]" << missing << "dead letters in" << path
+                          << "have no packet bytes (logging.deadletter_packets was off); skipped";
+    }
+    letters.erase(noPacket, letters.end());
+    return queueReplay(letters, perSecond);
+}
 
-void DDSCore::resendPacket(const Pending& p) {
-    qCDebug(LogQoS) << "[RESEND] mid=" << p.msg_id << " to=" << p.to.toString() << ":" << p.port << " attempt=" << p.attempt << " size=" << p.packet.size();
-    net->send(p.packet, p.to, p.port);
+int DDSCore::queueReplay(const QVector<DeadLetterRecord>& letters, int perSecond) {
+    for (const DeadLetterRecord& r : letters) replayQueue.append(r);
+    // 10 ticks a second; a low rate still sends one per tick
+    replayPerTick = qMax(1, perSecond / 10);
+    if (!replayQueue.isEmpty() && !replayTimer.isActive()) replayTimer.start(100);
+    qCInfo(LogQoS) << "[REPLAY] queued" << letters.size() << "dead letters, waiting=" << replayQueue.size()
+                   << "rate/s=" << replayPerTick * 10;
+    return int(letters.size());
+}
+
+void DDSCore::replayTick() {
+    int budget = replayPerTick;
+    for (auto it = replayQueue.begin(); it != replayQueue.end() && budget > 0;) {
+        if (!routeTo(it->receiver_id)) { ++it; continue; }
+        const auto view = Serializer::decodeEnvelopeView(it->packet);
+        if (!view || view->type != PacketType::Data || view->filtered) {
+            qCWarning(LogQoS) << "[REPLAY] dropping undecodable dead letter mid=" << it->msg_id;
+            it = replayQueue.erase(it);
+            continue;
+        }
+        // The receiver's window has most likely moved past the original seq (and
+        // its message id), so the sample is republished as a new one of our
+        // reliable stream; the other readers of the topic get a seq-only stub.
+        TopicState& st = state(TopicRegistry::instance().intern(view->topic));
+        const auto toReceiver = [&](const PeerRoute& r) { return r.peer == it->receiver_id; };
+        if (std::none_of(st.routes.cbegin(), st.routes.cend(), toReceiver)) {
+            qCWarning(LogQoS) << "[REPLAY] dropping mid=" << it->msg_id << ":" << it->receiver_id
+                              << "no longer reads topic" << view->topic;
+            it = replayQueue.erase(it);
+            continue;
+        }
+        MessageEnvelope m = view->toEnvelope();
+        m.qos = QStringLiteral("reliable");
+        m.publisher_id = node_id;
+        m.message_id = next_msg_id++;
+        m.incarnation = incarnation;
+        m.seq = ++st.nextSeq;
+        sendMessage(m, st, true, it->receiver_id);
+        qCInfo(LogQoS) << "[REPLAY] mid=" << it->msg_id << " as mid=" << m.message_id << " seq=" << m.seq
+                       << " to=" << it->receiver_id << " topic=" << m.topic;
+        ++replaySent;
+        --budget;
+        it = replayQueue.erase(it);
+    }
+    if (replayQueue.isEmpty()) {
+        replayTimer.stop();
+        emit replayDrained(replaySent);
+        replaySent = 0;
+    }
 }
 
 QVector<PeerInfo> DDSCore::get_known_peers() const {
@@ -322,8 +1163,9 @@ void DDSCore::shutdown(int timeoutMs) {
 
 void DDSCore::deliverRetainLast(const QString& topic, const QString& receiverNodeId) {
     if (!ConfigManager::ref().qos_cfg.retain_last) return;
-    if (!last_by_topic_.contains(topic)) return;
-    const MessageEnvelope m = last_by_topic_.value(topic);
+    TopicState* st = findState(TopicRegistry::instance().find(topic));
+    if (!st || !st->retained) return;
+    const MessageEnvelope m = *st->retained;
     // Deliver to local subscribers
-    deliverToLocal(topic, m.payload, m.qos, m.message_id);
+    deliverToLocal(*st, m.payload, m.qos, m.message_id);
 }
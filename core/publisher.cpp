@@ -3,7 +3,10 @@
 #include "qos.h"
 #include <QDateTime>
 
-Publisher::Publisher(DDSCore& c, const QString& t) : core(c), topic(t) {}
+Publisher::Publisher(DDSCore& c, const QString& t) : core(c), topic(TopicRegistry::instance().intern(t)) {}
 qint64 Publisher::publish(const QJsonObject& payload, const QString& qos) {
     return core.publishInternal(topic, payload, qos);
 }
+bool Publisher::isBackpressured() const {
+    return core.isBackpressured(topic);
+}
@@ -1,4 +1,6 @@
 #include "subscriber.h"
 #include "dds_core.h"
-Subscriber::Subscriber(DDSCore& c, const QString& t, Callback cb)
-    : core(c), topic(t), callback(std::move(cb)) {}
\ No newline at end of file
+Subscriber::Subscriber(DDSCore& c, const QString& t, Callback cb, quint64 handle)
+    : core(c), topic(t), callback(std::move(cb)), id(handle) {}
+
+bool Subscriber::unsubscribe() { return core.unsubscribe(id); }
@@ -0,0 +1,40 @@
+#include "topic_registry.h"
+#include <QRandomGenerator>
+
+TopicRegistry& TopicRegistry::instance() {
+    static TopicRegistry registry;
+    return registry;
+}
+
+// 16 bits keep the epoch to at most three varint bytes on the wire
+TopicRegistry::TopicRegistry() : epoch_(1u + QRandomGenerator::global()->bounded(0xFFFFu)) {}
+
+TopicId TopicRegistry::intern(const QString& name) {
+    {
+        QReadLocker r(&lock_);
+        const auto it = ids_.constFind(name);
+        if (it != ids_.constEnd()) return *it;
+    }
+    QWriteLocker w(&lock_);
+    const auto it = ids_.constFind(name);   // raced with another intern
+    if (it != ids_.constEnd()) return *it;
+    names_.append(name);
+    const TopicId id = TopicId(names_.size());
+    ids_.insert(name, id);
+    return id;
+}
+
+TopicId TopicRegistry::find(const QString& name) const {
+    QReadLocker r(&lock_);
+    return ids_.value(name, 0);
+}
+
+QString TopicRegistry::name(TopicId id) const {
+    QReadLocker r(&lock_);
+    return id >= 1 && id <= TopicId(names_.size()) ? names_[int(id - 1)] : QString();
+}
+
+int TopicRegistry::size() const {
+    QReadLocker r(&lock_);
+    return int(names_.size());
+}
@@ -0,0 +1 @@
+#include "../include/topic_registry.h"
@@ -52,6 +52,12 @@ void DiscoveryManager::sendAnnouncement() {
     pkt.serialization = supported;
     pkt.udp_port = dataPort;  // Use actual bound port for data
     pkt.tcp_port = cfg.transport.tcp.port;
+    pkt.qos_modes = QStringList{QStringLiteral("best_effort"), QStringLiteral("reliable"), QStringLiteral("reliable_nack")};
+    // Our ids for the topics we take, so senders can put them on the wire instead of names
+    TopicRegistry& registry = TopicRegistry::instance();
+    for (const QString& t : std::as_const(topics)) pkt.topic_ids.insert(t, registry.intern(t));
+    pkt.topic_epoch = registry.epoch();
+    pkt.content_filters = contentFilters;
     QByteArray datagram = Serializer::encodeDiscovery(pkt, "json"); // Use JSON for discovery
     if (loopbackMode) {
         socket.writeDatagram(datagram, QHostAddress::LocalHost, port);
@@ -85,11 +91,14 @@ void DiscoveryManager::processPendingDatagrams() {
         info.serialization_formats = pkt.serialization;
         info.udp_port = pkt.udp_port;
         info.tcp_port = pkt.tcp_port;
+        info.qos_modes = pkt.qos_modes;
         {
             QMutexLocker locker(&peerMutex);
             peerTable[info.node_id] = info;
         }
-        emit peerUpdated(info.node_id, Serializer::to_json(pkt));
+        QJsonObject payload = Serializer::to_json(pkt);
+        payload["transport_hint"] = info.transport_hint;
+        emit peerUpdated(info.node_id, payload);
         qCInfo(LogDisc) << "discovery: peer=" << info.node_id << "topics=" << info.topics.size() << "(ver=" << info.proto_version << ", formats=" << info.serialization_formats << ")";
     }
 }
@@ -129,13 +138,17 @@ QStringList DiscoveryManager::serialization_formats_for(const QString& node_id)
 void DiscoveryManager::expirePeers() {
     const qint64 now = QDateTime::currentSecsSinceEpoch();
     const int expiry = 10; // 10 seconds for demo runs
-    QMutexLocker locker(&peerMutex);
     QList<QString> toRemove;
-    for (auto it = peerTable.begin(); it != peerTable.end(); ++it) {
-        if (now - it.value().last_seen > expiry) {
-            toRemove << it.key();
-            qInfo(LogDisc) << "discovery: expired peer=" << it.key() << "(age=" << (now - it.value().last_seen) << "s)";
+    {
+        QMutexLocker locker(&peerMutex);
+        for (auto it = peerTable.begin(); it != peerTable.end(); ++it) {
+            if (now - it.value().last_seen > expiry) {
+                toRemove << it.key();
+                qInfo(LogDisc) << "discovery: expired peer=" << it.key() << "(age=" << (now - it.value().last_seen) << "s)";
+            }
         }
+        for (const auto& k : toRemove) peerTable.remove(k);
     }
-    for (const auto& k : toRemove) peerTable.remove(k);
+    // Outside the lock: receivers may query the table
+    for (const auto& k : std::as_const(toRemove)) emit peerExpired(k);
 }
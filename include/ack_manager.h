@@ -3,8 +3,15 @@
 #include <QByteArray>
 #include <QHostAddress>
 #include <QHash>
+#include <QMap>
+#include <QQueue>
 #include <QTimer>
 #include <QVector>
+#include <memory>
+#include <optional>
+#include "flat_u64_map.h"
+#include "deadletter_writer.h"
+#include "topic_registry.h"
 
 struct Pending {
     QByteArray packet;
@@ -17,6 +24,19 @@ struct Pending {
     quint16 port = 0;
     qint64 msg_id = 0;
     QString receiver_id;
+    qint64 sent_ms = 0; // first transmission; stamped by track() when left 0
+    QString topic;      // name, for the dead-letter log
+    TopicId topic_id = 0; // with seq: lets a cumulative/selective ACK retire this entry
+    quint64 seq = 0;
+};
+
+// Smoothed round-trip estimate for one receiver (RFC 6298 style)
+struct RttEstimate {
+    QString receiver_id;
+    double srtt_ms = 0;
+    double rttvar_ms = 0;
+    qint64 rto_ms = 0;
+    int samples = 0;
 };
 
 struct DeadLetter {
@@ -31,21 +51,99 @@ class AckManager : public QObject {
 public:
     explicit AckManager(QObject* parent=nullptr);
     void track(const Pending& p);
+    // Tracks `p` if the receiver's send window has room and returns true (send
+    // it now). Otherwise queues it and returns false; it is tracked and handed
+    // out through dispatch() once ACKs open the window.
+    bool submit(const Pending& p);
     void ackReceived(qint64 msg_id, const QString& receiverId);
-    bool hasPending() const { return !pending.isEmpty(); }
+    // Retires every tracked seq <= cumSeq on (receiver, topic), plus cumSeq + 1 + i
+    // for each set bit i of sackBits. Returns the msg_ids retired.
+    QVector<qint64> ackRange(const QString& receiverId, TopicId topic, quint64 cumSeq, quint32 sackBits);
+    // Lowest seq on (receiver, topic) not yet acknowledged, in flight or queued;
+    // 0 when there is none. Everything below it is retired or given up.
+    quint64 oldestSeq(const QString& receiverId, TopicId topic) const;
+    bool hasPending() const { return !pending.isEmpty() || queued_total > 0; }
+    int queuedCount() const { return queued_total; }
+    int queuedFor(const QString& receiverId) const;
+    // Current congestion window (messages in flight allowed) towards a receiver
+    int windowFor(const QString& receiverId) const;
     const QVector<DeadLetter>& deadLetters() const { return dead_letters; }
     int deadLetterSize() const { return dead_letters.size(); }
+    // Blocks until every dead letter so far is in logging.deadletter_file
+    void flushDeadLetters();
+    // The receiver went away: its slot is reused once nothing of its is in
+    // flight or queued. A receiver that comes back before that keeps it.
+    void releaseReceiver(const QString& receiverId);
+    int receiverCount() const { return receiver_ids.size(); } // receivers holding a slot
     int ackCount() const { return ack_count; }
+    int pendingCount() const { return pending.size(); }
+    // Per-receiver RTT diagnostics; only receivers with at least one sample
+    QVector<RttEstimate> rttEstimates() const;
+    std::optional<RttEstimate> rttFor(const QString& receiverId) const;
+    // Fires retries/give-ups for entries due at `now_ms`; the internal timer calls
+    // this every tick, tests and benchmarks can drive it directly.
+    void processTimeouts(qint64 now_ms);
 signals:
     void resend(const Pending& p);
+    // All retransmits due in one tick, emitted after the per-entry resend signals
+    void resendBatch(const QVector<Pending>& due);
+    // Queued messages the window now admits; they are already tracked
+    void dispatch(const QVector<Pending>& ready);
+    // A receiver's queue became non-empty (true) or drained (false)
+    void backpressure(const QString& receiverId, bool congested);
     void failed(qint64 msg_id, const QString& receiverId);
     void deadLetter(qint64 messageId, QString receiverId, int attempts, QString reason);
 private slots:
     void onTick();
 private:
-    static QString makeKey(qint64 msg_id, const QString& receiverId);
-    void appendDeadLetter(qint64 id, const QString& rx, int attempts, const QString& reason);
-    QHash<QString, Pending> pending;
+    // Pending records are keyed by (receiver index << 48 | msg_id low 48 bits).
+    // Receiver node ids are interned into at most kMaxReceivers slots, which
+    // releaseReceiver() recycles; -1 when every slot is taken.
+    static constexpr int kMaxReceivers = 0xFFFF; // 0xFFFF << 48 would reach the map's empty key
+    int internReceiver(const QString& receiverId);
+    void reclaim();
+    static quint64 makeKey(quint16 receiverIdx, qint64 msg_id) {
+        return (quint64(receiverIdx) << 48) | (quint64(msg_id) & 0xFFFFFFFFFFFFULL);
+    }
+    void schedule(quint64 key, qint64 deadline_ms);
+    void expire(quint64 key, Pending& p, qint64 now, QVector<Pending>& due);
+    void sampleRtt(quint16 receiverIdx, qint64 rtt_ms);
+    void retire(quint64 key, const Pending& p, bool sample);
+    void giveUp(Pending p, qint64 now, const QString& reason);
+    static quint64 streamKey(quint16 receiverIdx, TopicId topic) { return (quint64(receiverIdx) << 32) | topic; }
+    void grow(quint16 receiverIdx);
+    void shrink(quint16 receiverIdx, qint64 now);
+    void release();
+
+    // Per-receiver AIMD send window: +1/cwnd per ACK, halved on a timeout at
+    // most once per RTO. Messages beyond the window wait in `queued`.
+    struct SendWindow {
+        double cwnd = 1;
+        int in_flight = 0;
+        qint64 last_cut_ms = 0;
+        QQueue<Pending> queued;
+        bool released = false; // freed by reclaim() once idle
+    };
+
+    // Hashed timer wheel: slot = (deadline / kSlotMs) % kWheelSlots. Entries are
+    // dropped lazily: an ACK only removes the pending record, and a wheel entry
+    // whose deadline no longer matches its record is stale.
+    static constexpr int kWheelSlots = 512;
+    static constexpr qint64 kSlotMs = 10;
+    struct WheelEntry { quint64 key; qint64 deadline_ms; };
+    QVector<QVector<WheelEntry>> wheel;
+    qint64 wheel_cursor = 0; // absolute slot index processed last
+    void appendDeadLetter(const Pending& p, const QString& reason, qint64 now);
+    std::unique_ptr<DeadLetterWriter> dl_writer; // opened on the first dead letter
+    FlatU64Map<Pending> pending;
+    QHash<QString, quint16> receiver_ids;
+    QVector<RttEstimate> rtt; // indexed by interned receiver
+    QVector<SendWindow> windows; // indexed by interned receiver
+    QVector<quint16> releasing;  // released receivers still holding messages
+    QVector<quint16> free_slots; // reusable receiver indices
+    int queued_total = 0;
+    // (receiver << 32 | topic) -> outstanding seq -> msg_id, for range ACKs
+    FlatU64Map<QMap<quint64, qint64>> streams;
     QVector<DeadLetter> dead_letters;
     QTimer timer;
     int ack_count = 0;
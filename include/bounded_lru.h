@@ -1,23 +1,173 @@
 #pragma once
-#include <QList>
-#include <QSet>
-#include <QString>
+#include <QtGlobal>
+#include <QHashFunctions>
+#include <QStringView>
+#include <algorithm>
+#include <vector>
 
+// 64-bit FNV-1a over UTF-16 code units. Lets callers key a BoundedLRU<quint64>
+// by strings without storing them; chain calls through `seed` for composite
+// keys (publisher, topic, ...).
+inline quint64 lruKey64(QStringView s, quint64 seed = 14695981039346656037ULL) {
+    for (QChar c : s) {
+        seed ^= c.unicode();
+        seed *= 1099511628211ULL;
+    }
+    return seed;
+}
+
+template <typename Key>
+struct BoundedLRUHash {
+    quint64 operator()(const Key& k) const { return quint64(qHash(k)); }
+};
+
+template <>
+struct BoundedLRUHash<quint64> {
+    quint64 operator()(quint64 k) const { return k; }
+};
+
+// Fixed-capacity set that forgets its oldest key when full. Each key is stored
+// once, in a node array threaded oldest -> newest by index; an open-addressing
+// table of node indexes (linear probing, backward-shift deletion) finds it.
+// Nothing allocates after construction.
+template <typename Key, typename Hash = BoundedLRUHash<Key>>
 class BoundedLRU {
 public:
-    explicit BoundedLRU(int capacity) : cap(capacity) {}
-    bool contains(const QString& key) const { return set.contains(key); }
-    void insert(const QString& key) {
-        if (set.contains(key)) return; // already seen, no update
-        if (order.size() >= cap) {
-            QString oldest = order.takeFirst();
-            set.remove(oldest);
+    explicit BoundedLRU(int capacity) : cap(qMax(1, capacity)), nodes(size_t(cap)) {
+        size_t n = 8;
+        while (n < size_t(cap) * 2) n <<= 1; // load <= 0.5
+        table.resize(n);
+        mask = n - 1;
+        clear();
+    }
+
+    int capacity() const { return cap; }
+    int size() const { return count; }
+    bool contains(const Key& key) const { return find(key) != kNoSlot; }
+
+    // Adds `key` as the newest entry, evicting the oldest when full. Returns
+    // false, leaving the order alone, when it is already present.
+    bool insert(const Key& key) {
+        if (find(key) != kNoSlot) return false;
+        int n;
+        if (count == cap) {
+            n = head;
+            eraseSlot(find(nodes[n].key));
+            unlink(n);
+            --count;
+        } else {
+            n = freeHead;
+            freeHead = nodes[n].next;
+        }
+        nodes[n].key = key;
+        pushNewest(n);
+        size_t i = slotFor(key);
+        while (table[i] != kNone) i = (i + 1) & mask;
+        table[i] = n;
+        ++count;
+        return true;
+    }
+
+    // Marks `key` as the newest entry; false when absent.
+    bool touch(const Key& key) {
+        const size_t slot = find(key);
+        if (slot == kNoSlot) return false;
+        const int n = table[slot];
+        if (n != tail) {
+            unlink(n);
+            pushNewest(n);
+        }
+        return true;
+    }
+
+    bool remove(const Key& key) {
+        const size_t slot = find(key);
+        if (slot == kNoSlot) return false;
+        const int n = table[slot];
+        eraseSlot(slot);
+        unlink(n);
+        nodes[n].key = Key();
+        nodes[n].next = freeHead;
+        freeHead = n;
+        --count;
+        return true;
+    }
+
+    void clear() {
+        std::fill(table.begin(), table.end(), kNone);
+        for (int i = 0; i < cap; ++i) {
+            nodes[size_t(i)].key = Key();
+            nodes[size_t(i)].next = i + 1 < cap ? i + 1 : kNone;
         }
-        order.append(key);
-        set.insert(key);
+        freeHead = 0;
+        head = tail = kNone;
+        count = 0;
     }
+
+    // Oldest key, i.e. the next one insert() evicts; only valid when size() > 0.
+    const Key& oldest() const { return nodes[size_t(head)].key; }
+
 private:
+    static constexpr int kNone = -1;
+    static constexpr size_t kNoSlot = ~size_t(0);
+
+    struct Node {
+        Key key{};
+        int prev = kNone;
+        int next = kNone;
+    };
+
+    static quint64 mix(quint64 k) { // splitmix64 finalizer
+        k ^= k >> 30; k *= 0xbf58476d1ce4e5b9ULL;
+        k ^= k >> 27; k *= 0x94d049bb133111ebULL;
+        return k ^ (k >> 31);
+    }
+    size_t slotFor(const Key& key) const { return size_t(mix(Hash()(key))) & mask; }
+
+    size_t find(const Key& key) const {
+        size_t i = slotFor(key);
+        while (table[i] != kNone) {
+            if (nodes[size_t(table[i])].key == key) return i;
+            i = (i + 1) & mask;
+        }
+        return kNoSlot;
+    }
+
+    // Shift later members of the probe run back so lookups never need tombstones
+    void eraseSlot(size_t i) {
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask; table[j] != kNone; j = (j + 1) & mask) {
+            const size_t home = slotFor(nodes[size_t(table[j])].key);
+            const bool movable = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+            if (movable) {
+                table[hole] = table[j];
+                hole = j;
+            }
+        }
+        table[hole] = kNone;
+    }
+
+    void unlink(int n) {
+        Node& node = nodes[size_t(n)];
+        if (node.prev != kNone) nodes[size_t(node.prev)].next = node.next; else head = node.next;
+        if (node.next != kNone) nodes[size_t(node.next)].prev = node.prev; else tail = node.prev;
+        node.prev = node.next = kNone;
+    }
+
+    void pushNewest(int n) {
+        Node& node = nodes[size_t(n)];
+        node.prev = tail;
+        node.next = kNone;
+        if (tail != kNone) nodes[size_t(tail)].next = n; else head = n;
+        tail = n;
+    }
+
     int cap;
-    QList<QString> order; // front is oldest
-    QSet<QString> set;
-};
\ No newline at end of file
+    std::vector<Node> nodes;
+    std::vector<int> table;   // node index per slot, kNone when empty
+    size_t mask = 0;
+    int head = kNone;         // oldest
+    int tail = kNone;         // newest
+    int freeHead = kNone;     // unused nodes, chained through `next`
+    int count = 0;
+};
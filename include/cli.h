@@ -4,7 +4,7 @@
 #include <optional>
 
 struct CliOptions {
-    QString role; // "sender" or "subscriber"
+    QString role; // "sender", "subscriber" or "replay-deadletters"
     QString topic = "sensor/temperature";
     QString qos = "reliable";
     int count = 1;
@@ -16,10 +16,14 @@ struct CliOptions {
     int startDelayMs = 0;      // NEW: delay before starting sender
     bool printRecv = false;    // NEW: print received messages to stdout
     int runForSec = 0;         // NEW: run for N seconds then exit
+    QString deadletterFile;    // replay source; empty = logging.deadletter_file
+    int replayRate = 50;       // replayed packets per second
+    QString contentFilter;     // subscriber only; empty = every sample
 
     // Helper methods
     bool isSender() const { return role == "sender"; }
     bool isSubscriber() const { return role == "subscriber"; }
+    bool isReplay() const { return role == "replay-deadletters"; }
     bool isReliable() const { return qos == "reliable"; }
 };
 
@@ -5,6 +5,7 @@
 #include <QStringList>
 #include <QList>
 #include <QPair>
+#include <QHash>
 #include <QJsonObject>
 #include <QFileSystemWatcher>
 
@@ -17,10 +18,23 @@ struct DiscoveryConfig {
     int ttl = 1; // optional, for multicast hops
 };
 
+struct UdpMulticastConfig {
+    bool enabled = false;                      // data plane over per-topic groups
+    QHostAddress group_base = QHostAddress(QStringLiteral("239.255.100.0")); // hashed groups: base/24
+    QHash<QString, QHostAddress> topic_groups; // explicit topic -> group overrides
+    int ttl = 1;
+    bool loopback = true;                      // deliver to other nodes on this host
+};
+
 struct UdpConfig {
     quint16 port = 38020;
     int rcvbuf = 262144;                       // bytes
     int sndbuf = 262144;                       // bytes
+    int rx_batch = 32;                         // datagrams drained per recvmmsg call (Linux)
+    bool gso = false;                          // UDP_SEGMENT for same-peer send bursts (Linux)
+    bool io_thread = false;                    // receive on a dedicated thread (Linux)
+    int rx_ring = 256;                         // batches queued between that thread and the core (datagram-sized copies)
+    UdpMulticastConfig multicast;
 };
 
 struct TcpConnectTarget {
@@ -42,6 +56,7 @@ struct TcpConfig {
 
 struct TransportConfig {
     QString default_protocol = "udp";          // "udp" | "tcp"
+    bool intra_process = true;                 // hand publishes to same-core subscribers directly
     UdpConfig udp;
     TcpConfig tcp;
 };
@@ -50,18 +65,32 @@ struct QosReliable {
     int  ack_timeout_ms = 200;
     int  max_retries = 3;
     bool exponential_backoff = true;
+    bool adaptive_rto = true;                  // per-peer RTO from measured RTT once samples exist
+    int  min_rto_ms = 50;
+    int  max_rto_ms = 3000;
+    int  ack_delay_ms = 5;                     // receivers coalesce stream ACKs for this long
+    int  window_initial = 8;                   // per-peer messages in flight before the first ACK
+    int  max_in_flight = 64;                   // AIMD window cap per peer
+    int  max_queue = 1024;                     // sends waiting for window; oldest dead-lettered beyond
+};
+
+struct QosNack {
+    int history_depth = 256;                   // samples per topic kept for repair
+    int heartbeat_ms = 100;                    // announce the newest seq this often
+    int nack_delay_ms = 10;                    // receivers coalesce gap reports for this long
 };
 
 struct QosConfig {
-    QString def = "best_effort";               // "best_effort" | "reliable"
+    QString def = "best_effort";               // "best_effort" | "reliable" | "reliable_nack"
     QosReliable reliable;
-    int dedup_capacity = 2048;                 // LRU capacity for de-duplication
+    QosNack nack;
+    int dedup_capacity = 2048;                 // unused: receive dedup is a fixed window per writer
     bool retain_last = false;                  // retain last message per topic
 };
 
 struct SerializationConfig {
-    QString format = "json";                   // "json" | "cbor"
-    QStringList supported = {"json", "cbor"};  // ordered by preference
+    QString format = "json";                   // "json" | "cbor" | "bin"
+    QStringList supported = {"json", "cbor", "bin"};  // ordered by preference
     bool allow_json_fallback = true;
 };
 
@@ -69,6 +98,7 @@ struct LoggingConfig {
     QString level = "info";
     QString file = "logs/dds.log";
     QString deadletter_file = "logs/dds_deadletter.ndjson";
+    bool deadletter_packets = false;           // keep packet bytes in a .bin sidecar for replay
 };
 
 class ConfigManager : public QObject {
@@ -0,0 +1,40 @@
+#pragma once
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <optional>
+
+// A subscription's content filter, e.g. `value > 30 AND unit = 'C'`.
+// Grammar: comparisons `field op literal` joined with AND / OR / NOT and
+// parentheses (keywords in any case). `field` is a payload key, dotted for
+// nested objects (`pos.x`); `op` is one of = == != <> < <= > >=; a literal is
+// a number, a 'quoted' string ('' for a quote) or true/false. A comparison
+// against a missing field or a value of another type is false.
+// Compiled once into a flat predicate tree; matches() only walks it.
+class ContentFilter {
+public:
+    // Nullopt on a syntax error, described in `error`
+    static std::optional<ContentFilter> compile(const QString& expression, QString* error = nullptr);
+
+    bool matches(const QJsonObject& payload) const;
+    const QString& expression() const { return text; }
+
+private:
+    friend class ContentFilterParser;
+    enum class Op : quint8 { And, Or, Not, Eq, Ne, Lt, Le, Gt, Ge };
+    struct Node {
+        Op op = Op::Eq;
+        int lhs = -1;          // And/Or/Not operands
+        int rhs = -1;
+        QStringList path;      // comparisons: field, split at '.'
+        QJsonValue literal;
+    };
+
+    bool eval(int n, const QJsonObject& payload) const;
+
+    QString text;
+    QVector<Node> nodes;       // operands precede the node using them
+    int root = -1;
+};
@@ -1,17 +1,25 @@
 #pragma once
 #include <QObject>
 #include <QHash>
+#include <QSet>
+#include <QTimer>
 #include <QHostAddress>
 #include <QJsonObject>
+#include <QPair>
 #include <QVector>
 #include <QStringList>
+#include <memory>
+#include <optional>
 
 #include "serializer.h"
 #include "transport_base.h"
 #include "ack_manager.h"
 #include "topic.h"
+#include "topic_registry.h"
+#include "topic_trie.h"
+#include "content_filter.h"
 #include "subscriber.h"
-#include "bounded_lru.h"
+#include "seq_window.h"
 #include "logger.h"
 #include "discovery_manager.h"
 
@@ -24,11 +32,23 @@ public:
             ITransport* transport, AckManager* ack, QObject* parent=nullptr);
 
     class Publisher makePublisher(const QString& topic);
+    // Any number of subscribers per topic; each gets its own handle. `topic`
+    // may be an MQTT-style filter ("sensor/+/temp", "sensor/#").
     class Subscriber makeSubscriber(const QString& topic, Subscriber::Callback cb);
+    // Only samples whose payload matches `contentFilter` (see ContentFilter)
+    // reach `cb`; an empty filter takes everything.
+    class Subscriber makeSubscriber(const QString& topic, const QString& contentFilter, Subscriber::Callback cb);
+    bool unsubscribe(quint64 handle);
+    // Subscriptions delivering `topic`, filters included
+    int subscriberCount(const QString& topic) const;
 
     void onDatagram(const QByteArray& bytes, QHostAddress from, quint16 port);
+    void onDatagramBatch(const QVector<Datagram>& batch);
     void updatePeers(const QString& peerId, const QJsonObject& payload);
+    void removePeer(const QString& peerId);
     QStringList advertisedTopics() const;
+    // Topics whose every subscription has a content filter -> those filters
+    QHash<QString, QStringList> advertisedContentFilters() const;
     void deliverToLocal(const QString& topic, const QJsonObject& payload, const QString& qos, qint64 msg_id);
 
     void shutdown(int timeoutMs = 500);
@@ -37,31 +57,204 @@ public:
     QVector<PeerInfo> get_known_peers() const;
 
     qint64 publishInternal(const QString& topic, const QJsonObject& payload, const QString& qos);
+    qint64 publishInternal(TopicId topic, const QJsonObject& payload, const QString& qos);
+
+    // Multicast group carrying `topic` (null when transport.udp.multicast is off).
+    static QHostAddress multicastGroupFor(const QString& topic);
+
+    // True while reliable sends on `topic` wait for a peer's send window
+    bool isBackpressured(TopicId topic) const;
+
+    // Re-sends dead letters, each once its receiver is known to discovery
+    // again, at most `perSecond` packets per second. Replays are tracked like
+    // fresh reliable sends. Return the number queued.
+    int replayDeadLetters(int perSecond);                          // AckManager's in-memory ring
+    int replayDeadLetters(const QString& path, int perSecond);     // NDJSON log + .bin sidecar
+    int pendingReplays() const { return replayQueue.size(); }
+
+signals:
+    void backpressureChanged(const QString& peerId, bool congested);
+    void replayDrained(int sent);
 
 private slots:
-    void resendPacket(const Pending& p);
+    void resendPackets(const QVector<Pending>& due);
+    void sendQueued(const QVector<Pending>& ready);
     void onAckFailed(qint64 msg_id, const QString& receiverId);
+    void flushAcks();
+    void flushNacks();
+    void sendHeartbeats();
+    void replayTick();
 
 private:
-    void sendMessage(const MessageEnvelope& m, bool reliable);
+    // One destination of a topic, resolved when the peer's announcement arrives
+    struct PeerRoute {
+        QString peer;
+        QHostAddress addr;
+        quint16 port = 0;
+        QString format;        // negotiated serialization
+        bool nack = false;     // advertised reliable_nack
+        quint32 topicRef = 0;  // the peer's id for the topic (bin only), 0 = send the name
+        quint32 topicEpoch = 0;
+        bool started = false;  // heard where our reliable (ACK-mode) stream on the topic starts
+        // The peer's content filters for the topic; null = it takes every sample
+        std::shared_ptr<const QVector<ContentFilter>> where;
+    };
+    struct PeerEntry {
+        PeerRoute route;
+        QVector<TopicId> topics;
+        QStringList filters;              // advertised wildcard filters
+        QHash<QString, quint32> topicIds; // the peer's advertised ids
+        QJsonObject whereSpec;            // advertised content_filters, as received
+        QHash<QString, std::shared_ptr<const QVector<ContentFilter>>> where; // compiled
+    };
+    struct LocalSubscription {
+        quint64 id = 0;
+        Subscriber::Callback cb;
+        std::shared_ptr<const ContentFilter> where; // null = every sample
+    };
+    // Everything we keep per topic, indexed by TopicRegistry id
+    struct LastSample {                        // newest sample, for a late subscriber
+        QJsonObject payload;
+        QString qos;
+        qint64 message_id = 0;
+    };
+    struct TopicState {
+        TopicId id = 0;
+        TopicInfo info;                        // info.name always set
+        bool declared = false;                 // a local publisher or subscriber exists
+        QVector<LocalSubscription> subs;       // exact and matching filters, in subscription order
+        std::optional<LastSample> lastMsg;
+        std::optional<EnvelopeView> lastUndelivered; // still-encoded last sample of an unsubscribed topic
+        std::optional<MessageEnvelope> retained;     // for retain_last
+        quint64 nextSeq = 0;                   // last reliable seq we published
+        quint64 nextBestEffortSeq = 0;         // last best_effort seq we published
+        quint64 nextNackSeq = 0;               // last reliable_nack seq we published
+        QVector<PeerRoute> routes;             // remote destinations, filters included
+    };
+    struct FilterSubscription {
+        QString filter;
+        LocalSubscription sub;
+    };
+    // Grows topicStates on first use of an id, so a reference is only good
+    // until the next new topic (e.g. one created from a subscriber callback)
+    TopicState& state(TopicId id);
+    const TopicState* findState(TopicId id) const;
+    TopicState* findState(TopicId id);             // never creates one
+    void attachFilters(TopicState& st);
+    void addRoute(TopicState& st, const PeerEntry& e);
+    class Subscriber subscribeFilter(const QString& filter, const LocalSubscription& sub);
+    void catchUp(TopicState& st, const LocalSubscription& sub);
+    void advertiseContentFilters();
+    void deliverToLocal(TopicState& st, const QJsonObject& payload, const QString& qos, qint64 msg_id);
+
+    // onlyPeer: the sample is for that peer alone (dead-letter replay); the
+    // topic's other routes get a filtered stub carrying just the seq
+    void sendMessage(const MessageEnvelope& m, TopicState& st, bool reliable, const QString& onlyPeer = QString());
+    void joinTopicGroup(const QString& topic);
+    void leaveTopicGroup(const QString& topic);
+    static QVector<quint16> groupPorts(const QVector<PeerRoute>& routes);
+    const QVector<PeerRoute>& routesFor(TopicId topic) const;
+    const PeerRoute* routeTo(const QString& pid) const;
+    void unroute(const QString& pid);
+    Pending reliablePending(const QByteArray& packet, const QHostAddress& to, quint16 port, qint64 msgId,
+                            const QString& pid, const TopicState& topic, quint64 seq) const;
+    OutDatagram streamStart(const QString& pid, TopicId topic, const QString& name, quint64 seq,
+                            const QString& fmt, const QHostAddress& to, quint16 port) const;
+    int queueReplay(const QVector<DeadLetterRecord>& letters, int perSecond);
+    void repairFromHistory(const EnvelopeView& nack, const QHostAddress& from, quint16 port);
+    quint32 internPublisher(const QString& publisher);
+    void checkIncarnation(quint32 publisher, quint32 incarnation);
+    void forgetPublisher(quint32 publisher);
+    void releasePublisher(const QString& publisher);
+    void openAckStream(const EnvelopeView& hb, StreamKey id, const QHostAddress& from, quint16 port);
 
     QString node_id;
     QString protocol;
     ITransport* net = nullptr;
     AckManager* ack = nullptr;
 
-    QHash<QString, TopicInfo>     topics;
-    QHash<QString, Subscriber::Callback> subs;   // ← فقط callback نگه می‌داریم
+    QVector<TopicState> topicStates;               // [id - 1]
+    QHash<quint64, TopicId> subscriptionTopics;    // handle -> topic, 0 for filters
+    // Wildcard filters, ours and peers'. A topic is matched once, when its
+    // TopicState is created, and again only when a filter comes or goes; the
+    // result lives in the state's subs/routes, so delivery never walks these.
+    QHash<quint64, FilterSubscription> filterSubs; // handle -> filter
+    TopicTrie<quint64> localFilters;               // filter -> handles
+    TopicTrie<QString> peerFilters;                // filter -> peer ids
+    quint64 nextSubscriptionId = 1;
     QHash<QString, QJsonObject>   peers;
-    QHash<QString, QJsonObject>   lastMsg;
-    BoundedLRU                    seenMessages;  // for de-duplication
     qint64 next_msg_id = 1;
-    QMap<QString, QSet<qint64>> perTopicDedup;
     DiscoveryManager* discoveryManager = nullptr;
-    QHash<QString, QString> peerFormats; // node_id -> chosen format
-    QHash<QString, MessageEnvelope> last_by_topic_; // for retain_last
+    // Routing index (TopicState::routes): updatePeers()/removePeer() keep it
+    // current, so a publish reads only its own topic's destinations. Touched
+    // on the core's thread only.
+    QHash<QString, PeerEntry> routePeers;               // node_id -> route + advertised topics
+    QSet<QString> joinedTopics; // topics whose multicast group we joined
+
+    // Sequence numbers: we stamp our own streams, and acknowledge remote
+    // reliable streams with one cumulative/selective ACK per flush. The stream
+    // windows are also the duplicate filter: a fixed 64-seq window per
+    // (publisher, topic), whatever the QoS. Each QoS numbers its own stream,
+    // so best-effort samples never open holes in what a reliable reader ACKs.
+    // Streams are keyed by (publisher index << 32 | TopicId): a packet costs
+    // one node-id lookup, and no topic name is hashed on the receive path.
+    using StreamKey = quint64;
+    static StreamKey streamKey(quint32 publisher, TopicId topic) { return (quint64(publisher) << 32) | topic; }
+    struct RemotePublisher {
+        quint32 incarnation = 0;               // last seen; a change means a restart
+        SeqWindow mids;                        // message ids of packets without a seq
+    };
+    QHash<QString, quint32> publisherIndex;    // node id -> remotePublishers slot
+    QVector<RemotePublisher> remotePublishers;
+    QVector<quint32> freePublishers;           // slots of expired peers, reused first
+    struct AckStream {
+        SeqWindow window;
+        QString publisher;
+        QString topic;
+        QHostAddress to;
+        quint16 port = 0;
+        QString format;   // reply in the format the publisher sent
+        quint64 announced = 0; // nack streams: newest seq the publisher's heartbeat reported
+        // ack streams: nothing is acknowledged until the publisher's heartbeat
+        // says where the stream starts; seqs delivered before that wait in `early`
+        bool opened = false;
+        QVector<quint64> early;
+    };
+    QHash<StreamKey, AckStream> ackStreams;
+    QSet<StreamKey> dirtyAckStreams;           // streams owing an ACK
+    QTimer ackFlushTimer;
+    QHash<StreamKey, SeqWindow> bestEffortStreams; // duplicate filter only, never acknowledged
+    // Our data packets carry `incarnation`, random per DDSCore; a publisher
+    // whose incarnation changes has restarted, and its windows start over.
+    const quint32 incarnation;
+
+    // reliable_nack: we keep the newest qos.nack.history_depth samples of each
+    // topic for repair and heartbeat the range after writes; readers report
+    // holes instead of acknowledging. These streams number independently of
+    // the ACK-mode ones above.
+    struct NackHistory {
+        QVector<MessageEnvelope> ring;         // slot seq % ring.size()
+        quint64 last = 0;
+        int heartbeatsLeft = 0;
+        quint64 first() const { return last > quint64(ring.size()) ? last - ring.size() + 1 : 1; }
+        const MessageEnvelope* find(quint64 seq) const {
+            if (seq == 0 || seq > last || seq < first()) return nullptr;
+            const MessageEnvelope& m = ring[int(seq % quint64(ring.size()))];
+            return m.seq == seq ? &m : nullptr;
+        }
+    };
+    QHash<TopicId, NackHistory> nackHistory;   // topic -> samples held for repair
+    QHash<StreamKey, AckStream> nackStreams;
+    QSet<StreamKey> dirtyNackStreams;          // streams with holes to report
+    QTimer nackFlushTimer;
+    QTimer heartbeatTimer;
+
+    QList<DeadLetterRecord> replayQueue;       // waiting for their receiver to reappear
+    QTimer replayTimer;
+    int replayPerTick = 1;
+    int replaySent = 0;
 
 public:
-    void setDiscoveryManager(DiscoveryManager* dm) { discoveryManager = dm; }
+    void setDiscoveryManager(DiscoveryManager* dm);
     void deliverRetainLast(const QString& topic, const QString& receiverNodeId);
 };
@@ -0,0 +1,58 @@
+#pragma once
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <QWaitCondition>
+
+class QThread;
+
+struct DeadLetterRecord {
+    qint64 ts_ms = 0;
+    qint64 msg_id = 0;
+    QString receiver_id;
+    int attempts = 0;
+    QString reason;
+    QByteArray packet;             // written to the sidecar when enabled
+};
+
+// Appends dead letters to an NDJSON file from a background thread. The file
+// stays open, and whatever queued up while the last batch was written goes
+// out in one write. With `withPackets`, the packet bytes are appended to a
+// binary sidecar and each line records "packet_offset"/"packet_size" into it.
+class DeadLetterWriter {
+public:
+    DeadLetterWriter(const QString& path, bool withPackets);
+    ~DeadLetterWriter();                       // writes out the queue, then joins
+
+    void append(DeadLetterRecord r);           // never touches the file
+    void flush();                              // returns once everything appended so far is written
+    quint64 written() const;
+
+    QString path() const { return path_; }
+    // "<dir>/<name>.bin" next to the NDJSON file
+    static QString sidecarPathFor(const QString& path);
+    // Reads a dead-letter log back; `packet` is filled from the sidecar when
+    // the line points into it. Malformed lines are skipped. Reading starts at
+    // byte `from`, and `end` receives the offset reading stopped at.
+    static QVector<DeadLetterRecord> readAll(const QString& path, qint64 from = 0, qint64* end = nullptr);
+    // "<path>.replayed": log offset up to which records were already replayed
+    static QString replayCursorPathFor(const QString& path);
+    static qint64 replayCursor(const QString& path);  // 0 when absent or past the end of the log
+    static bool setReplayCursor(const QString& path, qint64 offset);
+
+private:
+    void run();
+
+    const QString path_;
+    const bool withPackets_;
+    QThread* thread_ = nullptr;
+
+    mutable QMutex mutex_;
+    QWaitCondition wake_;                      // writer: records queued or stopping
+    QWaitCondition done_;                      // flush(): a batch hit the file
+    QVector<DeadLetterRecord> queue_;
+    quint64 appended_ = 0;
+    quint64 written_ = 0;
+    bool stopping_ = false;
+};
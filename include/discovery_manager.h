@@ -24,6 +24,7 @@ struct PeerInfo {
     QStringList serialization_formats;
     quint16 udp_port = 0;
     quint16 tcp_port = 0;
+    QStringList qos_modes;
 };
 
 class DiscoveryManager : public QObject {
@@ -41,6 +42,8 @@ public:
     void setMulticastAddress(const QHostAddress& a) { mcastAddr = a; }
     void setLoopbackMode(bool enable) { loopbackMode = enable; }
     void setAdvertisedTopics(const QStringList& t) { topics = t; }
+    // topic -> content filters covering all our subscriptions to it (DDSCore keeps this current)
+    void setContentFilters(const QHash<QString, QStringList>& f) { contentFilters = f; }
     void setDataPort(quint16 p) { dataPort = p; }
     QVector<PeerInfo> list_peers() const;
     bool has_peer(const QString& node_id) const;
@@ -53,7 +56,9 @@ public:
     void stop();
 
 signals:
+    // payload is the announcement plus "transport_hint", the sender's address
     void peerUpdated(const QString& nodeId, const QJsonObject& payload);
+    void peerExpired(const QString& nodeId);
 
 private slots:
     void sendAnnouncement();
@@ -74,6 +79,7 @@ private:
     QString mode = "broadcast";
     QHostAddress mcastAddr = QHostAddress("239.255.0.1");
     QStringList topics;
+    QHash<QString, QStringList> contentFilters;
     quint16 dataPort = 0;
     bool loopbackMode = false;
 
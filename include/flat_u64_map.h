@@ -0,0 +1,105 @@
+#pragma once
+#include <QtGlobal>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash map from quint64 keys to V with linear probing and
+// backward-shift deletion (no tombstones). The all-ones key is reserved as the
+// empty marker. Pointers returned by find() are invalidated by insert/erase.
+template <typename V>
+class FlatU64Map {
+public:
+    static constexpr quint64 kEmpty = ~quint64(0);
+
+    explicit FlatU64Map(int initialCapacity = 16) { rehash(roundUp(initialCapacity)); }
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+
+    V* find(quint64 key) {
+        size_t i = slotFor(key);
+        while (slots[i].key != kEmpty) {
+            if (slots[i].key == key) return &slots[i].value;
+            i = (i + 1) & mask;
+        }
+        return nullptr;
+    }
+    const V* find(quint64 key) const { return const_cast<FlatU64Map*>(this)->find(key); }
+    bool contains(quint64 key) const { return find(key) != nullptr; }
+
+    // Inserts or overwrites; returns the stored value.
+    V& insert(quint64 key, V value) {
+        Q_ASSERT(key != kEmpty);
+        if (size_t(count + 1) * 4 > (mask + 1) * 3) rehash((mask + 1) * 2); // load <= 0.75
+        size_t i = slotFor(key);
+        while (slots[i].key != kEmpty) {
+            if (slots[i].key == key) { slots[i].value = std::move(value); return slots[i].value; }
+            i = (i + 1) & mask;
+        }
+        slots[i].key = key;
+        slots[i].value = std::move(value);
+        ++count;
+        return slots[i].value;
+    }
+
+    bool erase(quint64 key) {
+        size_t i = slotFor(key);
+        while (slots[i].key != key) {
+            if (slots[i].key == kEmpty) return false;
+            i = (i + 1) & mask;
+        }
+        // Shift later members of the probe run back so lookups never need tombstones
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask; slots[j].key != kEmpty; j = (j + 1) & mask) {
+            const size_t home = slotFor(slots[j].key);
+            const bool movable = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+            if (movable) {
+                slots[hole] = std::move(slots[j]);
+                hole = j;
+            }
+        }
+        slots[hole].key = kEmpty;
+        slots[hole].value = V();
+        --count;
+        return true;
+    }
+
+    void clear() {
+        for (auto& s : slots) { s.key = kEmpty; s.value = V(); }
+        count = 0;
+    }
+
+    // Calls fn(key, value&) for every entry; fn must not insert or erase.
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        for (auto& s : slots) if (s.key != kEmpty) fn(s.key, s.value);
+    }
+
+private:
+    struct Slot { quint64 key = kEmpty; V value{}; };
+
+    static size_t roundUp(int n) {
+        size_t c = 8;
+        while (c < size_t(n)) c <<= 1;
+        return c;
+    }
+    static quint64 mix(quint64 k) { // splitmix64 finalizer
+        k ^= k >> 30; k *= 0xbf58476d1ce4e5b9ULL;
+        k ^= k >> 27; k *= 0x94d049bb133111ebULL;
+        return k ^ (k >> 31);
+    }
+    size_t slotFor(quint64 key) const { return size_t(mix(key)) & mask; }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.resize(capacity);
+        mask = capacity - 1;
+        count = 0;
+        for (auto& s : old) if (s.key != kEmpty) insert(s.key, std::move(s.value));
+    }
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    int count = 0;
+};
@@ -1,11 +1,15 @@
 #pragma once
 #include <QString>
 #include <QJsonObject>
+#include "topic_registry.h"
 class DDSCore;
 class Publisher {
 public:
     Publisher(DDSCore& core, const QString& topic);
     qint64 publish(const QJsonObject& payload, const QString& qos = "best_effort");
+    // Reliable samples are queued behind a full peer send window; callers
+    // that can slow down should while this is true.
+    bool isBackpressured() const;
 private:
-    DDSCore& core; QString topic;
+    DDSCore& core; TopicId topic; // interned once; publishes skip the name lookup
 };
@@ -7,7 +7,7 @@
 namespace mbus {
 
 // QoS levels
-enum class QosLevel { BestEffort, Reliable };
+enum class QosLevel { BestEffort, Reliable, ReliableNack };
 
 // Reliable settings (config-driven)
 struct ReliableSettings {
@@ -31,3 +31,9 @@ struct QosPolicy {
 inline bool isReliable(const QString& qos) {
     return qos.compare("reliable", Qt::CaseInsensitive) == 0;
 }
+
+// Receiver-driven reliability: gaps are reported (NACK) and repaired from the
+// publisher's history instead of every sample being acknowledged.
+inline bool isNackReliable(const QString& qos) {
+    return qos.compare("reliable_nack", Qt::CaseInsensitive) == 0;
+}
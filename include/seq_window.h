@@ -0,0 +1,63 @@
+#pragma once
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+// Receive window over one stream's sequence numbers (1, 2, 3, ...).
+// `base` is the highest seq up to which everything arrived; bit i of `bits`
+// records base + 1 + i. A seq that lands more than 64 past base slides the
+// window, and the skipped seqs are treated as lost.
+class SeqWindow {
+public:
+    static constexpr int kWidth = 64;
+
+    // Records `seq`; returns false when it was already seen. A publisher that
+    // restarts its numbering gets a fresh window (see DDSCore's incarnations).
+    bool accept(quint64 seq) {
+        if (seq <= base) return false;
+        quint64 off = seq - base - 1;
+        if (off >= quint64(kWidth)) {
+            const quint64 shift = off - kWidth + 1;
+            bits = shift >= quint64(kWidth) ? 0 : bits >> shift;
+            base += shift;
+            off = kWidth - 1;
+        }
+        const quint64 mask = quint64(1) << off;
+        if (bits & mask) return false;
+        bits |= mask;
+        while (bits & 1) { bits >>= 1; ++base; } // fold the contiguous prefix into base
+        return true;
+    }
+
+    bool seen(quint64 seq) const {
+        if (seq <= base) return true;
+        const quint64 off = seq - base - 1;
+        return off < quint64(kWidth) && (bits >> off) & 1;
+    }
+
+    quint64 cumulative() const { return base; }
+    quint32 sackBits() const { return quint32(bits); } // the first 32 seqs above base
+    quint64 highest() const { return bits ? base + kWidth - qCountLeadingZeroBits(bits) : base; }
+
+    // Holes among the first 32 seqs above base, up to `upTo` (or the highest
+    // seq seen, whichever is larger); bit i marks base + 1 + i as missing.
+    quint32 missingBits(quint64 upTo = 0) const {
+        const quint64 top = qMax(upTo, highest());
+        if (top <= base) return 0;
+        const quint64 span = qMin<quint64>(top - base, 32);
+        const quint32 mask = span == 32 ? ~quint32(0) : (quint32(1) << span) - 1;
+        return ~quint32(bits) & mask;
+    }
+
+    // Gives up on every seq below `seq` (the publisher no longer holds them).
+    void skipTo(quint64 seq) {
+        if (seq <= base + 1) return;
+        const quint64 shift = seq - 1 - base;
+        bits = shift >= quint64(kWidth) ? 0 : bits >> shift;
+        base = seq - 1;
+        while (bits & 1) { bits >>= 1; ++base; }
+    }
+
+private:
+    quint64 base = 0;
+    quint64 bits = 0;
+};
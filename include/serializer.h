@@ -5,9 +5,14 @@
 #include <QCborValue>
 #include <QString>
 #include <QStringList>
+#include <QHash>
 #include <optional>
+#include "topic_registry.h"
 
-enum class PacketType { Unknown, Discovery, Data, Ack };
+enum class PacketType { Unknown, Discovery, Data, Ack, Sack, Nack, Heartbeat };
+
+// On-wire encoding of a datagram, detected from its leading bytes
+enum class WireFormat { Unknown, Json, Cbor, Binary };
 
 struct DiscoveryPacket {
     QString node_id;
@@ -18,6 +23,12 @@ struct DiscoveryPacket {
     QStringList serialization;
     quint16 udp_port = 0;
     quint16 tcp_port = 0;
+    QStringList qos_modes;         // reliability modes the node speaks; empty = pre-NACK peer
+    QHash<QString, quint32> topic_ids; // the sender's interned id per advertised topic
+    quint32 topic_epoch = 0;       // TopicRegistry::epoch() of the sender; 0 = no ids
+    // Content filters per topic, for topics whose every local subscription
+    // has one; a publisher may withhold samples none of them match
+    QHash<QString, QStringList> content_filters;
 };
 
 struct MessageEnvelope {
@@ -27,15 +38,110 @@ struct MessageEnvelope {
     qint64 timestamp = 0;
     QString qos;
     QString publisher_id;
+    quint64 seq = 0;   // per (publisher, topic) sequence, starting at 1; 0 = not carried
+    // Random per publisher process; a new value tells receivers the seqs and
+    // message ids restarted. 0 = not carried (older publishers)
+    quint32 incarnation = 0;
+    // bin only: the receiver's id for `topic` (from its discovery topic_ids),
+    // sent with its epoch instead of the name. 0 = send the name.
+    quint32 topic_ref = 0;
+    quint32 topic_epoch = 0;
+    // The receiver's content filter rejected this sample: the packet keeps
+    // the stream's seq and an empty payload, and is not delivered
+    bool filtered = false;
+};
+
+// Stream control for one (publisher, topic) stream.
+//   sack     : every seq up to cum_seq arrived; bit i of sack_bits marks cum_seq + 1 + i as received.
+//   nack     : every seq up to cum_seq arrived; bit i of sack_bits marks cum_seq + 1 + i as missing.
+//   heartbeat: the publisher holds first_seq..cum_seq for repair (receiver_id empty when multicast).
+//              With qos "reliable" it is for one reader's ACK-mode stream: every seq
+//              below first_seq is acknowledged or abandoned, so the reader starts there.
+struct SackPacket {
+    QString topic;
+    QString publisher_id;          // owner of the stream
+    QString receiver_id;
+    quint64 cum_seq = 0;
+    quint32 sack_bits = 0;
+    quint64 first_seq = 0;         // heartbeat only
+    qint64 timestamp = 0;
+    QString qos;                   // heartbeat only: "reliable" for an ACK-mode stream, else reliable_nack
+    quint32 incarnation = 0;       // heartbeat only: publisher process, 0 = not carried
 };
 
+// Header fields of a received data/ack packet, read straight from the wire
+// without building a QJsonObject. The payload stays encoded inside the
+// (implicitly shared) datagram until payload() is called.
+struct EnvelopeView {
+    PacketType type = PacketType::Unknown;
+    WireFormat format = WireFormat::Unknown;
+    QString topic;
+    TopicId topic_id = 0;          // our registry id when the packet carried one instead of the name
+    bool filtered = false;         // data: seq placeholder, payload withheld by the publisher
+    QString publisher_id;
+    QString receiver_id;           // ack only
+    QString status;                // ack only (bin)
+    QString qos;
+    qint64 message_id = 0;
+    qint64 timestamp = 0;
+    quint64 seq = 0;               // data
+    quint32 incarnation = 0;       // data/heartbeat: publisher process, 0 = not carried
+    quint64 cum_seq = 0;           // sack/nack/heartbeat
+    quint32 sack_bits = 0;         // sack/nack
+    quint64 first_seq = 0;         // heartbeat
+
+    QByteArray raw;                // datagram the view refers to
+    int payload_offset = -1;       // cbor/bin: encoded payload inside raw
+    int payload_size = 0;
+    QJsonObject json_payload;      // json: parsed together with the header
+
+    QJsonObject payload() const;
+    MessageEnvelope toEnvelope() const;
+};
+
+// Compact binary envelope ("bin"). Fixed header followed by varint fields;
+// no field names are carried on the wire.
+//   [magic0][magic1][version][kind][flags]
+//   data: varint message_id, varint timestamp, [varint seq if HasSeq], [varint incarnation if HasIncarnation], [varint epoch if TopicById], ref topic, ref publisher, varint len + CBOR payload
+//   ack : varint message_id, varint timestamp, ref receiver, ref status
+//   sack: varint cum_seq, varint sack_bits, varint timestamp, ref topic, ref publisher, ref receiver
+//   nack: same layout as sack, sack_bits marking missing seqs
+//   heartbeat: varint first_seq, varint cum_seq, [varint incarnation if HasIncarnation], varint timestamp, ref topic, ref publisher, ref receiver
+//              (qos bits QosReliable mark an ACK-mode stream)
+// A "ref" is a varint whose low bit selects an interned id (1) or an inline
+// UTF-8 string (0); the remaining bits hold the id or the string length. Only
+// the data topic uses ids: the receiver's TopicRegistry id, valid when the
+// preceding epoch matches its registry.
+namespace BinaryWire {
+    constexpr quint8 kMagic0  = 0xDB;
+    constexpr quint8 kMagic1  = 0x4D;
+    constexpr quint8 kVersion = 1;
+    enum Kind : quint8 { KindData = 0x01, KindAck = 0x02, KindSack = 0x03, KindNack = 0x04, KindHeartbeat = 0x05 };
+    enum Flags : quint8 {
+        QosMask         = 0x03,  // 0 = best_effort, 1 = reliable, 2 = reliable_nack
+        QosBestEffort   = 0x00,
+        QosReliable     = 0x01,
+        QosReliableNack = 0x02,
+        HasSeq          = 0x04,  // data carries a stream sequence number
+        TopicById       = 0x08,  // data topic is an id in the receiver's topic table
+        Filtered        = 0x10,  // data payload withheld (receiver's content filter)
+        HasIncarnation  = 0x20,  // data/heartbeat carries the publisher's incarnation
+    };
+    constexpr int kHeaderSize = 5;
+}
+
 namespace Serializer {
     QByteArray encodeDiscovery(const QString& nodeId, const QStringList& topics,
                                 const QString& proto, qint64 ts, quint16 data_port,
                                 const QStringList& serialization = QStringList());
     QByteArray encodeData(const MessageEnvelope& m);
     QByteArray encodeAck(qint64 messageId, const QString& receiverId, const QString& status, qint64 ts);
+    // Sniffs the format and runs exactly one parser
     std::optional<QJsonObject> decode(const QByteArray& bytes, PacketType* outType);
+    WireFormat detectFormat(const QByteArray& bytes);
+    std::optional<QJsonObject> decodeJSON(const QByteArray& bytes, PacketType* outType);
+    // Data/ack header decode for the receive path; payload is decoded lazily
+    std::optional<EnvelopeView> decodeEnvelopeView(const QByteArray& bytes);
 
     // CBOR encoding functions
     QByteArray encodeDiscoveryCBOR(const QString& nodeId, const QStringList& topics,
@@ -45,6 +151,15 @@ namespace Serializer {
     QByteArray encodeAckCBOR(qint64 messageId, const QString& receiverId, const QString& status, qint64 ts);
     std::optional<QJsonObject> decodeCBOR(const QByteArray& bytes, PacketType* outType);
 
+    // Compact binary encoding functions
+    QByteArray encodeDataBinary(const MessageEnvelope& m);
+    QByteArray encodeAckBinary(qint64 messageId, const QString& receiverId, const QString& status, qint64 ts);
+    std::optional<QJsonObject> decodeBinary(const QByteArray& bytes, PacketType* outType);
+    bool isBinary(const QByteArray& bytes);
+    // A TopicById data packet re-encoded with `topic` inline, for keeping it
+    // past the receiver's epoch (dead letters); other packets come back as is.
+    QByteArray withTopicName(const QByteArray& packet, const QString& topic);
+
     // Format negotiation
     QString negotiateFormat(const QStringList& ourPrefs, const QStringList& peerPrefs);
     // DiscoveryPacket helpers
@@ -61,4 +176,7 @@ namespace Serializer {
     std::optional<DiscoveryPacket> decodeDiscovery(const QByteArray& bytes, const QString& fmt);
     QByteArray encodeAck(qint64 messageId, const QString& receiverId, const QString& status, qint64 ts, const QString& fmt);
     std::optional<QJsonObject> decodeAck(const QByteArray& bytes, const QString& fmt);
+    QByteArray encodeSack(const SackPacket& s, const QString& fmt);
+    QByteArray encodeNack(const SackPacket& s, const QString& fmt);
+    QByteArray encodeHeartbeat(const SackPacket& s, const QString& fmt);
 }
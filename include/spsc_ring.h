@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Single-producer/single-consumer ring. One thread calls tryPush, one other
+// thread calls tryPop; neither blocks. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(int capacity) {
+        size_t n = 2;
+        while (n < size_t(capacity)) n <<= 1;
+        buf.resize(n);
+        mask = n - 1;
+    }
+
+    bool tryPush(T&& v) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) return false; // full
+        buf[t & mask] = std::move(v);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& out) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false; // empty
+        out = std::move(buf[h & mask]);
+        buf[h & mask] = T();
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    int capacity() const { return int(mask + 1); }
+
+private:
+    std::vector<T> buf;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> head{0}; // consumer side
+    alignas(64) std::atomic<size_t> tail{0}; // producer side
+};
@@ -9,11 +9,15 @@ class DDSCore;  // forward decl
 class Subscriber {
 public:
     using Callback = std::function<void(const QJsonObject&)>;
-    Subscriber(DDSCore& core, const QString& topic, Callback cb);
+    Subscriber(DDSCore& core, const QString& topic, Callback cb, quint64 handle = 0);
     QString topicName() const { return topic; }
+    quint64 handle() const { return id; }
+    // Stops callbacks for this subscription; other subscribers of the topic keep theirs
+    bool unsubscribe();
 private:
     DDSCore& core;
     QString  topic;
     Callback callback;
+    quint64  id = 0;
     friend class DDSCore;
 };
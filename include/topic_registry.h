@@ -0,0 +1,32 @@
+#pragma once
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+using TopicId = quint32; // 0 = no topic
+
+// Process-wide topic name table. Every name gets a small id on first use and
+// keeps it for the life of the process, so per-topic state can live in arrays
+// indexed by id. Ids are local: discovery advertises ours ("topic_ids") with
+// the table's random epoch, and peers put our id on the wire instead of the
+// name when they send to us.
+class TopicRegistry {
+public:
+    static TopicRegistry& instance();
+
+    TopicId intern(const QString& name);
+    TopicId find(const QString& name) const;   // 0 when never interned
+    QString name(TopicId id) const;            // empty for unknown ids
+    int size() const;
+    // Distinguishes this process's ids from a previous run's (never 0)
+    quint32 epoch() const { return epoch_; }
+
+private:
+    TopicRegistry();
+
+    const quint32 epoch_;
+    mutable QReadWriteLock lock_;
+    QHash<QString, TopicId> ids_;
+    QVector<QString> names_;                   // names_[id - 1]
+};
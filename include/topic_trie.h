@@ -0,0 +1,135 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+
+// Topic filters in a prefix trie over '/'-separated levels, MQTT style:
+// '+' matches exactly one level, '#' (last level only) matches the rest,
+// including nothing ("sensor/#" matches "sensor"). Plain names are filters
+// too and only match themselves. Each filter holds any number of values.
+// Lookups walk the topic's levels once; callers cache the result per topic.
+template <typename Value>
+class TopicTrie {
+public:
+    TopicTrie() : nodes(1) {}
+
+    static bool isPattern(const QString& topic) {
+        for (const QString& level : topic.split(QLatin1Char('/'))) {
+            if (level == QLatin1String("+") || level == QLatin1String("#")) return true;
+        }
+        return false;
+    }
+
+    // '+' and '#' must fill a whole level, and '#' must be the last one
+    static bool isValidFilter(const QString& filter) {
+        if (filter.isEmpty()) return false;
+        const QStringList levels = filter.split(QLatin1Char('/'));
+        for (int i = 0; i < levels.size(); ++i) {
+            const QString& l = levels[i];
+            if (l.contains(QLatin1Char('#')) && (l.size() != 1 || i + 1 != levels.size())) return false;
+            if (l.contains(QLatin1Char('+')) && l.size() != 1) return false;
+        }
+        return true;
+    }
+
+    // One filter against one topic, without building a trie
+    static bool matches(const QString& filter, const QString& topic) {
+        const QStringList f = filter.split(QLatin1Char('/'));
+        const QStringList t = topic.split(QLatin1Char('/'));
+        for (int i = 0; i < f.size(); ++i) {
+            if (f[i] == QLatin1String("#")) return true;
+            if (i == t.size()) return false;
+            if (f[i] != QLatin1String("+") && f[i] != t[i]) return false;
+        }
+        return f.size() == t.size();
+    }
+
+    void insert(const QString& filter, const Value& v) {
+        int n = 0;
+        const QStringList levels = filter.split(QLatin1Char('/'));
+        for (const QString& level : levels) {
+            if (level == QLatin1String("#")) {
+                nodes[size_t(n)].rest.append(v);
+                ++count;
+                return;
+            }
+            n = child(n, level);
+        }
+        nodes[size_t(n)].here.append(v);
+        ++count;
+    }
+
+    // Removes one `v` under `filter`; nodes stay, filters are few and reused
+    bool remove(const QString& filter, const Value& v) {
+        int n = 0;
+        const QStringList levels = filter.split(QLatin1Char('/'));
+        for (const QString& level : levels) {
+            if (level == QLatin1String("#")) return take(nodes[size_t(n)].rest, v);
+            const Node& node = nodes[size_t(n)];
+            n = level == QLatin1String("+") ? node.plus : node.children.value(level, kNone);
+            if (n == kNone) return false;
+        }
+        return take(nodes[size_t(n)].here, v);
+    }
+
+    // Values of every filter matching `topic`; a value under two matching
+    // filters appears twice
+    QVector<Value> match(const QString& topic) const {
+        QVector<Value> out;
+        if (count) collect(0, topic.split(QLatin1Char('/')), 0, out);
+        return out;
+    }
+
+    bool isEmpty() const { return count == 0; }
+
+private:
+    static constexpr int kNone = -1;
+
+    struct Node {
+        QHash<QString, int> children; // literal next level
+        int plus = kNone;             // '+' next level
+        QVector<Value> here;          // filters ending at this node
+        QVector<Value> rest;          // filters ending in '#' below this node
+    };
+
+    int child(int n, const QString& level) {
+        if (level == QLatin1String("+")) {
+            if (nodes[size_t(n)].plus == kNone) {
+                nodes[size_t(n)].plus = int(nodes.size());
+                nodes.emplace_back();
+            }
+            return nodes[size_t(n)].plus;
+        }
+        const auto it = nodes[size_t(n)].children.constFind(level);
+        if (it != nodes[size_t(n)].children.constEnd()) return *it;
+        const int c = int(nodes.size());
+        nodes.emplace_back(); // may move nodes; index n stays valid
+        nodes[size_t(n)].children.insert(level, c);
+        return c;
+    }
+
+    void collect(int n, const QStringList& levels, int i, QVector<Value>& out) const {
+        const Node& node = nodes[size_t(n)];
+        out += node.rest;
+        if (i == levels.size()) {
+            out += node.here;
+            return;
+        }
+        const int lit = node.children.value(levels[i], kNone);
+        if (lit != kNone) collect(lit, levels, i + 1, out);
+        if (node.plus != kNone) collect(node.plus, levels, i + 1, out);
+    }
+
+    bool take(QVector<Value>& list, const Value& v) {
+        const qsizetype i = list.indexOf(v);
+        if (i < 0) return false;
+        list.remove(i);
+        --count;
+        return true;
+    }
+
+    std::vector<Node> nodes; // [0] is the root
+    int count = 0;
+};
@@ -2,6 +2,19 @@
 #include <QObject>
 #include <QByteArray>
 #include <QHostAddress>
+#include <QVector>
+
+struct Datagram {
+    QByteArray bytes;
+    QHostAddress from;
+    quint16 port = 0;
+};
+
+struct OutDatagram {
+    QByteArray bytes;
+    QHostAddress to;
+    quint16 port = 0;
+};
 
 class ITransport : public QObject {
     Q_OBJECT
@@ -9,7 +22,19 @@ public:
     using QObject::QObject;
     virtual bool send(const QByteArray& datagram, const QHostAddress& to, quint16 port) = 0;
     virtual quint16 boundPort() const = 0;
+    // Sends every datagram in order; returns how many were handed to the network.
+    // Transports with a vectored send override this, others fall back to send().
+    virtual int sendBatch(const QVector<OutDatagram>& batch) {
+        int sent = 0;
+        for (const OutDatagram& d : batch) sent += send(d.bytes, d.to, d.port) ? 1 : 0;
+        return sent;
+    }
     virtual void stop() = 0;
+    // Multicast data plane; transports without group support return false
+    virtual bool joinGroup(const QHostAddress& group) { Q_UNUSED(group); return false; }
+    virtual void leaveGroup(const QHostAddress& group) { Q_UNUSED(group); }
 signals:
     void datagramReceived(const QByteArray& bytes, QHostAddress from, quint16 port);
+    // Batched delivery; a transport emits either this or datagramReceived for a given datagram
+    void datagramsReceived(const QVector<Datagram>& batch);
 };
@@ -1,16 +1,73 @@
 #pragma once
 #include "transport/transport_base.h"
 #include <QUdpSocket>
+#include <QHash>
+#include <QVector>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include "spsc_ring.h"
+
+class QSocketNotifier;
 
 class UdpTransport : public ITransport {
     Q_OBJECT
 public:
+    struct Config {
+        quint16 port = 38020;
+        int rxBatch = 32;              // datagrams per recvmmsg call
+        int maxDatagramSize = 65536;   // receive slot size; larger datagrams are truncated by the kernel
+        bool gso = false;              // coalesce same-destination runs with UDP_SEGMENT (Linux 4.18+)
+        bool ioThread = false;         // receive on a dedicated thread (Linux), hand batches over via rxRing
+        int rxRing = 256;              // batches buffered between the receive thread and the core; each holds
+                                       // up to rxBatch datagrams copied at their own size
+        int rcvbuf = 0;                // SO_RCVBUF request in bytes (0 = kernel default)
+        int sndbuf = 0;                // SO_SNDBUF request in bytes (0 = kernel default)
+    };
+
     explicit UdpTransport(quint16 bindPort, QObject* parent=nullptr);
+    explicit UdpTransport(const Config& cfg, QObject* parent=nullptr);
+    ~UdpTransport() override;
     bool send(const QByteArray& datagram, const QHostAddress& to, quint16 port) override;
+    int sendBatch(const QVector<OutDatagram>& batch) override;
     quint16 boundPort() const override;
     void stop() override;
+    bool joinGroup(const QHostAddress& group) override;
+    void leaveGroup(const QHostAddress& group) override;
+    void setMulticastOptions(int ttl, bool loopback);
+    // Datagrams discarded because the core did not drain the receive ring in time
+    quint64 rxRingDrops() const { return rxDrops_.load(std::memory_order_relaxed); }
+    // Datagrams the kernel dropped on a full receive queue (SO_RXQ_OVFL, Linux; 0 elsewhere)
+    quint64 kernelDrops() const { return kernelDrops_.load(std::memory_order_relaxed); }
+    // Buffer sizes the kernel actually granted, as reported back after applying the config
+    int effectiveRcvbuf() const { return effRcvbuf_; }
+    int effectiveSndbuf() const { return effSndbuf_; }
 private slots:
     void onReadyRead();
+    void drainRing();
 private:
+    void bindSocket(quint16 bindPort);
+    void applyBufferSizes();
+    int drainBatch(int fd, QVector<Datagram>& out); // recvmmsg fast path; returns datagrams read
+    void rxLoop(int fd);
+    void stopRxThread();
+    struct MmsgScratch;
+
+    Config cfg_;
     QUdpSocket sock;
+    QHash<quint32, int> groupRefs; // IPv4 group -> join count
+    QVector<QByteArray> rxSlots_;   // receive buffers, allocated once; datagrams are copied out of them
+    std::unique_ptr<MmsgScratch> rx_; // mmsghdr/iovec/sockaddr arrays reused across calls
+    QVector<Datagram> batch_;      // emitted batch, capacity kept between reads
+    QSocketNotifier* rxNotifier_ = nullptr; // event-loop receive on Linux, in place of readyRead
+
+    // Receive thread (Config::ioThread)
+    QThread* rxThread_ = nullptr;
+    std::unique_ptr<SpscRing<QVector<Datagram>>> ring_;
+    std::atomic<bool> rxStop_{false};
+    std::atomic<bool> wakeQueued_{false}; // a drainRing() call is already posted
+    std::atomic<quint64> rxDrops_{0};
+    std::atomic<quint64> kernelDrops_{0};
+    int effRcvbuf_ = 0;
+    int effSndbuf_ = 0;
 };
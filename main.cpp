@@ -71,7 +71,19 @@ int main(int argc, char *argv[]) {
     signal(SIGTERM, signalHandler);
 
     // Create transport
-    ITransport* transport = new UdpTransport(cfg.transport.udp.port, &app);
+    UdpTransport::Config udpCfg;
+    udpCfg.port = cfg.transport.udp.port;
+    udpCfg.rxBatch = cfg.transport.udp.rx_batch;
+    udpCfg.gso = cfg.transport.udp.gso;
+    udpCfg.ioThread = cfg.transport.udp.io_thread;
+    udpCfg.rxRing = cfg.transport.udp.rx_ring;
+    udpCfg.rcvbuf = cfg.transport.udp.rcvbuf;
+    udpCfg.sndbuf = cfg.transport.udp.sndbuf;
+    auto* udp = new UdpTransport(udpCfg, &app);
+    if (cfg.transport.udp.multicast.enabled) {
+        udp->setMulticastOptions(cfg.transport.udp.multicast.ttl, cfg.transport.udp.multicast.loopback);
+    }
+    ITransport* transport = udp;
 
     // Create ACK manager
     AckManager ack(&app);
@@ -93,11 +105,9 @@ int main(int argc, char *argv[]) {
         qInfo() << "cli: discovery loopback mode enabled for testing";
     }
 
-    QObject::connect(&discovery, &DiscoveryManager::peerUpdated, &core, &DDSCore::updatePeers);
-    discovery.start(cfg.disc.enabled);
-
-    // Connect discovery to core
+    // Connect discovery to core: announcements and expiries maintain its routing index
     core.setDiscoveryManager(&discovery);
+    discovery.start(cfg.disc.enabled);
 
     // Config hot reload
     cfg.startWatching(opts.config_path);
@@ -155,7 +165,7 @@ int main(int argc, char *argv[]) {
     } else if (opts.isSubscriber()) {
         auto topic = opts.topic;
         bool printRecv = opts.printRecv;
-        core.makeSubscriber(opts.topic, [topic, printRecv](const QJsonObject& payload) {
+        core.makeSubscriber(opts.topic, opts.contentFilter, [topic, printRecv](const QJsonObject& payload) {
             // Keep existing logging
             qInfo() << "[ts=" << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz") << "] "
                     << "topic=" << payload.value("topic").toString()
@@ -171,6 +181,30 @@ int main(int argc, char *argv[]) {
                                      .arg(QString::fromUtf8(d.toJson(QJsonDocument::Compact)));
             }
         });
+    } else if (opts.isReplay()) {
+        // Peers come back through discovery; replays wait for them, then we exit
+        // once every replay is acknowledged or dead-lettered again.
+        if (!cfg.logging.deadletter_packets) {
+            // Without packet bytes nothing can be resent, and letters that fail
+            // again would come back unreplayable
+            qCritical() << "cli: replay-deadletters needs logging.deadletter_packets: true";
+            return 1;
+        }
+        const QString path = opts.deadletterFile.isEmpty() ? cfg.logging.deadletter_file : opts.deadletterFile;
+        QObject::connect(&core, &DDSCore::replayDrained, &app, [&](int sent) {
+            qInfo() << "cli: replayed" << sent << "dead letters; waiting for ACKs";
+            auto* drainTimer = new QTimer(&app);
+            QObject::connect(drainTimer, &QTimer::timeout, &app, [&ack, drainTimer]() {
+                if (ack.hasPending()) return;
+                drainTimer->stop();
+                QCoreApplication::quit();
+            });
+            drainTimer->start(100);
+        });
+        if (core.replayDeadLetters(path, opts.replayRate) == 0) {
+            qInfo() << "cli: nothing to replay in" << path;
+            QTimer::singleShot(0, &app, &QCoreApplication::quit);
+        }
     }
 
     // Graceful shutdown handler
@@ -1,9 +1,12 @@
 #include "serializer.h"
+#include "qos.h"
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QCborMap>
 #include <QCborArray>
 #include <QCborValue>
+#include <QCborStreamReader>
+#include <QVariant>
 
 QByteArray Serializer::encodeDiscovery(const QString& nodeId, const QStringList& topics,
                                        const QString& proto, qint64 ts, quint16 data_port,
@@ -32,6 +35,9 @@ QByteArray Serializer::encodeData(const MessageEnvelope& m) {
         {"publisher_id", m.publisher_id},
         {"qos", m.qos}
     };
+    if (m.seq) o["seq"] = qint64(m.seq);
+    if (m.incarnation) o["incarnation"] = qint64(m.incarnation);
+    if (m.filtered) o["filtered"] = true;
     return QJsonDocument(o).toJson(QJsonDocument::Compact);
 }
 
@@ -46,34 +52,17 @@ QByteArray Serializer::encodeAck(qint64 messageId, const QString& receiverId, co
     return QJsonDocument(o).toJson(QJsonDocument::Compact);
 }
 
-std::optional<QJsonObject> Serializer::decode(const QByteArray& bytes, PacketType* outType) {
-    // Try CBOR first
-    QCborParserError cborErr;
-    QCborValue cbor = QCborValue::fromCbor(bytes, &cborErr);
-    if (cborErr.error == QCborError::NoError && cbor.isMap()) {
-        QCborMap map = cbor.toMap();
-        if (map.contains(QCborValue("type"))) {
-            auto result = decodeCBOR(bytes, outType);
-            if (result.has_value()) {
-                return result;
-            }
-        }
-    }
-
-    // Fallback to JSON
-    QJsonParseError err{};
-    auto doc = QJsonDocument::fromJson(bytes, &err);
-    if (err.error != QJsonParseError::NoError || !doc.isObject()) {
-        qWarning() << "[DROP][DECODE] parse error: CBOR=" << cborErr.errorString() << ", JSON=" << err.errorString();
-        if (outType) *outType = PacketType::Unknown;
-        return std::nullopt;
-    }
-    auto o = doc.object();
+// Classifies a decoded object by its "type" field and checks required fields.
+// Shared by the JSON and CBOR paths.
+static std::optional<QJsonObject> classifyAndValidate(QJsonObject o, PacketType* outType) {
     const auto t = o.value("type").toString();
     PacketType pt = PacketType::Unknown;
     if (t == "discovery") pt = PacketType::Discovery;
     else if (t == "data") pt = PacketType::Data;
     else if (t == "ack") pt = PacketType::Ack;
+    else if (t == "sack") pt = PacketType::Sack;
+    else if (t == "nack") pt = PacketType::Nack;
+    else if (t == "heartbeat") pt = PacketType::Heartbeat;
     if (outType) *outType = pt;
 
     // Validate required fields
@@ -95,6 +84,17 @@ std::optional<QJsonObject> Serializer::decode(const QByteArray& bytes, PacketTyp
         else if (o.contains("receiver")) receiverId = o.value("receiver").toString();
         else if (o.contains("to")) receiverId = o.value("to").toString();
         if (!receiverId.isEmpty()) o["receiver_node_id"] = receiverId;
+    } else if (pt == PacketType::Sack || pt == PacketType::Nack) {
+        if (!o.contains("cum_seq") || !o.contains("topic") || !o.contains("publisher_id") ||
+            !o.contains("receiver_node_id")) {
+            qWarning() << "[DROP][DECODE] missing required field in" << t << "packet";
+            return std::nullopt;
+        }
+    } else if (pt == PacketType::Heartbeat) {
+        if (!o.contains("cum_seq") || !o.contains("first_seq") || !o.contains("topic") || !o.contains("publisher_id")) {
+            qWarning() << "[DROP][DECODE] missing required field in heartbeat packet";
+            return std::nullopt;
+        }
     } else if (pt == PacketType::Discovery) {
         if (!o.contains("node_id") || !o.contains("topics") || !o.contains("data_port")) {
             qWarning() << "[DROP][DECODE] missing required field in discovery packet";
@@ -104,6 +104,55 @@ std::optional<QJsonObject> Serializer::decode(const QByteArray& bytes, PacketTyp
     return o;
 }
 
+WireFormat Serializer::detectFormat(const QByteArray& bytes) {
+    if (bytes.isEmpty()) return WireFormat::Unknown;
+    if (isBinary(bytes)) return WireFormat::Binary;
+    const quint8 first = quint8(bytes[0]);
+    // CBOR major type 5 (map): 0xA0..0xBF
+    if ((first & 0xE0) == 0xA0) return WireFormat::Cbor;
+    for (char c : bytes) {
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+        return c == '{' ? WireFormat::Json : WireFormat::Unknown;
+    }
+    return WireFormat::Unknown;
+}
+
+std::optional<QJsonObject> Serializer::decode(const QByteArray& bytes, PacketType* outType) {
+    switch (detectFormat(bytes)) {
+    case WireFormat::Binary:
+        return decodeBinary(bytes, outType);
+    case WireFormat::Cbor: {
+        PacketType pt = PacketType::Unknown;
+        auto result = decodeCBOR(bytes, &pt);
+        if (result && !result->contains("type")) {
+            qWarning() << "[DROP][DECODE] CBOR map without type";
+            result.reset();
+            pt = PacketType::Unknown;
+        }
+        if (outType) *outType = pt;
+        return result;
+    }
+    case WireFormat::Json:
+        return decodeJSON(bytes, outType);
+    case WireFormat::Unknown:
+        break;
+    }
+    qWarning() << "[DROP][DECODE] unrecognised packet format, len=" << bytes.size();
+    if (outType) *outType = PacketType::Unknown;
+    return std::nullopt;
+}
+
+std::optional<QJsonObject> Serializer::decodeJSON(const QByteArray& bytes, PacketType* outType) {
+    QJsonParseError err{};
+    auto doc = QJsonDocument::fromJson(bytes, &err);
+    if (err.error != QJsonParseError::NoError || !doc.isObject()) {
+        qWarning() << "[DROP][DECODE] JSON parse error:" << err.errorString();
+        if (outType) *outType = PacketType::Unknown;
+        return std::nullopt;
+    }
+    return classifyAndValidate(doc.object(), outType);
+}
+
 // Format negotiation
 QString Serializer::negotiateFormat(const QStringList& ourPrefs, const QStringList& peerPrefs) {
     if (peerPrefs.isEmpty()) {
@@ -154,6 +203,9 @@ QByteArray Serializer::encodeDataCBOR(const MessageEnvelope& m) {
     map[QCborValue("timestamp")] = QCborValue(m.timestamp);
     map[QCborValue("publisher_id")] = QCborValue(m.publisher_id);
     map[QCborValue("qos")] = QCborValue(m.qos);
+    if (m.seq) map[QCborValue("seq")] = QCborValue(qint64(m.seq));
+    if (m.incarnation) map[QCborValue("incarnation")] = QCborValue(qint64(m.incarnation));
+    if (m.filtered) map[QCborValue("filtered")] = QCborValue(true);
 
     // Convert QJsonObject payload to QCborMap
     QCborMap payloadMap;
@@ -236,54 +288,500 @@ std::optional<QJsonObject> Serializer::decodeCBOR(const QByteArray& bytes, Packe
         }
     }
 
-    const auto t = o.value("type").toString();
-    PacketType pt = PacketType::Unknown;
-    if (t == "discovery") pt = PacketType::Discovery;
-    else if (t == "data") pt = PacketType::Data;
-    else if (t == "ack") pt = PacketType::Ack;
-    if (outType) *outType = pt;
+    return classifyAndValidate(o, outType);
+}
 
-    // Validate required fields (same as JSON version)
-    if (pt == PacketType::Data) {
-        if (!o.contains("topic") || !o.contains("message_id") || !o.contains("payload") ||
-            !o.contains("publisher_id") || !o.contains("qos")) {
+// Compact binary encoding
+namespace {
+
+void putVarint(QByteArray& out, quint64 v) {
+    while (v >= 0x80) {
+        out.append(char((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.append(char(v));
+}
+
+void putInlineString(QByteArray& out, const QString& s) {
+    const QByteArray utf8 = s.toUtf8();
+    putVarint(out, quint64(utf8.size()) << 1); // low bit 0 = inline string
+    out.append(utf8);
+}
+
+void putHeader(QByteArray& out, quint8 kind, quint8 flags) {
+    out.append(char(BinaryWire::kMagic0));
+    out.append(char(BinaryWire::kMagic1));
+    out.append(char(BinaryWire::kVersion));
+    out.append(char(kind));
+    out.append(char(flags));
+}
+
+// Bounds-checked reader over a binary envelope
+struct BinaryReader {
+    const uchar* p;
+    const uchar* end;
+    bool ok = true;
+
+    quint64 varint() {
+        quint64 v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) { ok = false; return 0; }
+            const uchar b = *p++;
+            v |= quint64(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+
+    QByteArray bytes(quint64 n) {
+        if (!ok || n > quint64(end - p)) { ok = false; return {}; }
+        QByteArray b(reinterpret_cast<const char*>(p), int(n));
+        p += n;
+        return b;
+    }
+
+    QString ref() {
+        const quint64 v = varint();
+        if (!ok) return {};
+        if (v & 1) {
+            // Interned ids need a table shared with the sender; not resolvable here
+            ok = false;
+            return {};
+        }
+        return QString::fromUtf8(bytes(v >> 1));
+    }
+};
+
+} // namespace
+
+bool Serializer::isBinary(const QByteArray& bytes) {
+    return bytes.size() >= BinaryWire::kHeaderSize &&
+           quint8(bytes[0]) == BinaryWire::kMagic0 &&
+           quint8(bytes[1]) == BinaryWire::kMagic1;
+}
+
+QByteArray Serializer::encodeDataBinary(const MessageEnvelope& m) {
+    const QByteArray payload = QCborMap::fromJsonObject(m.payload).toCborValue().toCbor();
+    quint8 flags = isReliable(m.qos) ? BinaryWire::QosReliable
+                 : isNackReliable(m.qos) ? BinaryWire::QosReliableNack : BinaryWire::QosBestEffort;
+    if (m.seq) flags |= BinaryWire::HasSeq;
+    if (m.incarnation) flags |= BinaryWire::HasIncarnation;
+    const bool byId = m.topic_ref && m.topic_epoch;
+    if (byId) flags |= BinaryWire::TopicById;
+    if (m.filtered) flags |= BinaryWire::Filtered;
+
+    QByteArray out;
+    out.reserve(BinaryWire::kHeaderSize + 30 + m.topic.size() + m.publisher_id.size() + payload.size());
+    putHeader(out, BinaryWire::KindData, flags);
+    putVarint(out, quint64(m.message_id));
+    putVarint(out, quint64(m.timestamp));
+    if (m.seq) putVarint(out, m.seq);
+    if (m.incarnation) putVarint(out, m.incarnation);
+    if (byId) {
+        putVarint(out, m.topic_epoch);
+        putVarint(out, (quint64(m.topic_ref) << 1) | 1);
+    } else {
+        putInlineString(out, m.topic);
+    }
+    putInlineString(out, m.publisher_id);
+    putVarint(out, quint64(payload.size()));
+    out.append(payload);
+    return out;
+}
+
+QByteArray Serializer::withTopicName(const QByteArray& packet, const QString& topic) {
+    if (!isBinary(packet) || quint8(packet[3]) != BinaryWire::KindData ||
+        !(quint8(packet[4]) & BinaryWire::TopicById)) {
+        return packet;
+    }
+    const quint8 flags = quint8(packet[4]);
+    const auto* base = reinterpret_cast<const uchar*>(packet.constData());
+    BinaryReader r{base + BinaryWire::kHeaderSize, base + packet.size()};
+    r.varint(); // message_id
+    r.varint(); // timestamp
+    if (flags & BinaryWire::HasSeq) r.varint();
+    if (flags & BinaryWire::HasIncarnation) r.varint();
+    const auto* topicAt = r.p;
+    r.varint(); // epoch
+    r.varint(); // topic id
+    if (!r.ok) return packet;
+
+    QByteArray out;
+    out.reserve(packet.size() + topic.size());
+    putHeader(out, BinaryWire::KindData, quint8(flags & ~BinaryWire::TopicById));
+    out.append(reinterpret_cast<const char*>(base + BinaryWire::kHeaderSize), int(topicAt - base) - BinaryWire::kHeaderSize);
+    putInlineString(out, topic);
+    out.append(reinterpret_cast<const char*>(r.p), int(r.end - r.p));
+    return out;
+}
+
+QByteArray Serializer::encodeAckBinary(qint64 messageId, const QString& receiverId, const QString& status, qint64 ts) {
+    QByteArray out;
+    out.reserve(BinaryWire::kHeaderSize + 24 + receiverId.size() + status.size());
+    putHeader(out, BinaryWire::KindAck, 0);
+    putVarint(out, quint64(messageId));
+    putVarint(out, quint64(ts));
+    putInlineString(out, receiverId);
+    putInlineString(out, status);
+    return out;
+}
+
+// Shared by sack/nack/heartbeat; they differ only in kind and which seq
+// fields they carry.
+static QByteArray encodeStreamControl(PacketType type, const SackPacket& s, const QString& fmt) {
+    const bool heartbeat = type == PacketType::Heartbeat;
+    if (fmt == "bin") {
+        QByteArray out;
+        out.reserve(BinaryWire::kHeaderSize + 24 + s.topic.size() + s.publisher_id.size() + s.receiver_id.size());
+        quint8 flags = 0;
+        if (heartbeat && s.qos == "reliable") flags |= BinaryWire::QosReliable;
+        if (heartbeat && s.incarnation) flags |= BinaryWire::HasIncarnation;
+        putHeader(out, heartbeat ? BinaryWire::KindHeartbeat
+                       : type == PacketType::Nack ? BinaryWire::KindNack : BinaryWire::KindSack, flags);
+        putVarint(out, heartbeat ? s.first_seq : s.cum_seq);
+        putVarint(out, heartbeat ? s.cum_seq : s.sack_bits);
+        if (flags & BinaryWire::HasIncarnation) putVarint(out, s.incarnation);
+        putVarint(out, quint64(s.timestamp));
+        putInlineString(out, s.topic);
+        putInlineString(out, s.publisher_id);
+        putInlineString(out, s.receiver_id);
+        return out;
+    }
+    QJsonObject o{
+        {"type", heartbeat ? "heartbeat" : type == PacketType::Nack ? "nack" : "sack"},
+        {"topic", s.topic},
+        {"publisher_id", s.publisher_id},
+        {"receiver_node_id", s.receiver_id},
+        {"cum_seq", qint64(s.cum_seq)},
+        {"timestamp", s.timestamp}
+    };
+    if (heartbeat) {
+        o["first_seq"] = qint64(s.first_seq);
+        if (!s.qos.isEmpty()) o["qos"] = s.qos;
+        if (s.incarnation) o["incarnation"] = qint64(s.incarnation);
+    } else {
+        o["sack_bits"] = qint64(s.sack_bits);
+    }
+    if (fmt == "cbor") return QCborMap::fromJsonObject(o).toCborValue().toCbor();
+    return QJsonDocument(o).toJson(QJsonDocument::Compact);
+}
+
+QByteArray Serializer::encodeSack(const SackPacket& s, const QString& fmt) {
+    return encodeStreamControl(PacketType::Sack, s, fmt);
+}
+
+QByteArray Serializer::encodeNack(const SackPacket& s, const QString& fmt) {
+    return encodeStreamControl(PacketType::Nack, s, fmt);
+}
+
+QByteArray Serializer::encodeHeartbeat(const SackPacket& s, const QString& fmt) {
+    return encodeStreamControl(PacketType::Heartbeat, s, fmt);
+}
+
+// Envelope views
+namespace {
+
+QString readCborString(QCborStreamReader& r) {
+    QString out;
+    auto chunk = r.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        out += chunk.data;
+        chunk = r.readString();
+    }
+    return out;
+}
+
+// Reads the scalar under the cursor and advances past it
+QVariant readCborScalar(QCborStreamReader& r) {
+    if (r.isString()) return readCborString(r);
+    QVariant v;
+    if (r.isInteger()) v = qint64(r.toInteger());
+    else if (r.isDouble()) v = r.toDouble();
+    else if (r.isBool()) v = r.toBool();
+    r.next();
+    return v;
+}
+
+std::optional<EnvelopeView> viewFromCbor(const QByteArray& bytes) {
+    QCborStreamReader r(bytes);
+    if (!r.isMap() || !r.enterContainer()) return std::nullopt;
+
+    EnvelopeView v;
+    v.format = WireFormat::Cbor;
+    v.raw = bytes;
+    QString type;
+    bool hasTopic = false, hasMid = false, hasPublisher = false, hasQos = false, hasCum = false, hasFirst = false;
+    while (r.lastError() == QCborError::NoError && r.hasNext()) {
+        if (!r.isString()) { r.next(); r.next(); continue; }
+        const QString key = readCborString(r);
+        if (key == "payload") {
+            v.payload_offset = int(r.currentOffset());
+            r.next();
+            v.payload_size = int(r.currentOffset()) - v.payload_offset;
+            continue;
+        }
+        const QVariant value = readCborScalar(r);
+        if (key == "type") type = value.toString();
+        else if (key == "topic") { v.topic = value.toString(); hasTopic = true; }
+        else if (key == "message_id") { v.message_id = value.toLongLong(); hasMid = true; }
+        else if (key == "timestamp") v.timestamp = value.toLongLong();
+        else if (key == "publisher_id") { v.publisher_id = value.toString(); hasPublisher = true; }
+        else if (key == "qos") { v.qos = value.toString(); hasQos = true; }
+        else if (key == "seq") v.seq = quint64(value.toLongLong());
+        else if (key == "incarnation") v.incarnation = quint32(value.toLongLong());
+        else if (key == "filtered") v.filtered = value.toBool();
+        else if (key == "cum_seq") { v.cum_seq = quint64(value.toLongLong()); hasCum = true; }
+        else if (key == "sack_bits") v.sack_bits = quint32(value.toLongLong());
+        else if (key == "first_seq") { v.first_seq = quint64(value.toLongLong()); hasFirst = true; }
+        else if (key == "receiver_node_id" || key == "receiverId" || key == "receiver" || key == "to") {
+            if (v.receiver_id.isEmpty()) v.receiver_id = value.toString();
+        }
+    }
+    if (r.lastError() != QCborError::NoError) {
+        qWarning() << "[DROP][DECODE] CBOR parse error:" << r.lastError().toString();
+        return std::nullopt;
+    }
+
+    if (type == "data") {
+        v.type = PacketType::Data;
+        if (!hasTopic || !hasMid || v.payload_offset < 0 || !hasPublisher || !hasQos) {
             qWarning() << "[DROP][DECODE] missing required field in data packet";
             return std::nullopt;
         }
-    } else if (pt == PacketType::Ack) {
-        if (!o.contains("message_id")) {
+    } else if (type == "ack") {
+        v.type = PacketType::Ack;
+        if (!hasMid) {
             qWarning() << "[DROP][DECODE] missing message_id in ack packet";
             return std::nullopt;
         }
-        // Normalize receiver identity to "receiver_node_id"
-        QString receiverId;
-        if (o.contains("receiver_node_id")) receiverId = o.value("receiver_node_id").toString();
-        else if (o.contains("receiverId")) receiverId = o.value("receiverId").toString();
-        else if (o.contains("receiver")) receiverId = o.value("receiver").toString();
-        else if (o.contains("to")) receiverId = o.value("to").toString();
-        if (!receiverId.isEmpty()) o["receiver_node_id"] = receiverId;
-    } else if (pt == PacketType::Discovery) {
-        if (!o.contains("node_id") || !o.contains("topics") || !o.contains("data_port")) {
-            qWarning() << "[DROP][DECODE] missing required field in discovery packet";
+    } else if (type == "sack" || type == "nack") {
+        v.type = type == "sack" ? PacketType::Sack : PacketType::Nack;
+        if (!hasCum || !hasTopic || !hasPublisher || v.receiver_id.isEmpty()) {
+            qWarning() << "[DROP][DECODE] missing required field in" << type << "packet";
+            return std::nullopt;
+        }
+    } else if (type == "heartbeat") {
+        v.type = PacketType::Heartbeat;
+        if (!hasCum || !hasFirst || !hasTopic || !hasPublisher) {
+            qWarning() << "[DROP][DECODE] missing required field in heartbeat packet";
+            return std::nullopt;
+        }
+    } else if (type == "discovery") {
+        v.type = PacketType::Discovery;
+    }
+    return v;
+}
+
+std::optional<EnvelopeView> viewFromBinary(const QByteArray& bytes) {
+    if (quint8(bytes[2]) != BinaryWire::kVersion) {
+        qWarning() << "[DROP][DECODE] binary envelope: unsupported version" << quint8(bytes[2]);
+        return std::nullopt;
+    }
+    const quint8 kind = quint8(bytes[3]);
+    const quint8 flags = quint8(bytes[4]);
+    const auto* base = reinterpret_cast<const uchar*>(bytes.constData());
+    BinaryReader r{base + BinaryWire::kHeaderSize, base + bytes.size()};
+
+    EnvelopeView v;
+    v.format = WireFormat::Binary;
+    v.raw = bytes;
+    if (kind == BinaryWire::KindSack || kind == BinaryWire::KindNack || kind == BinaryWire::KindHeartbeat) {
+        if (kind == BinaryWire::KindHeartbeat) {
+            v.type = PacketType::Heartbeat;
+            v.first_seq = r.varint();
+            v.cum_seq = r.varint();
+            if (flags & BinaryWire::HasIncarnation) v.incarnation = quint32(r.varint());
+            if ((flags & BinaryWire::QosMask) == BinaryWire::QosReliable) v.qos = QStringLiteral("reliable");
+        } else {
+            v.type = kind == BinaryWire::KindSack ? PacketType::Sack : PacketType::Nack;
+            v.cum_seq = r.varint();
+            v.sack_bits = quint32(r.varint());
+        }
+        v.timestamp = qint64(r.varint());
+        v.topic = r.ref();
+        v.publisher_id = r.ref();
+        v.receiver_id = r.ref();
+        if (!r.ok) {
+            qWarning() << "[DROP][DECODE] binary envelope: truncated stream control kind" << kind;
+            return std::nullopt;
+        }
+        return v;
+    }
+    v.message_id = qint64(r.varint());
+    v.timestamp = qint64(r.varint());
+    if (kind == BinaryWire::KindData) {
+        v.type = PacketType::Data;
+        if (flags & BinaryWire::HasSeq) v.seq = r.varint();
+        if (flags & BinaryWire::HasIncarnation) v.incarnation = quint32(r.varint());
+        if (flags & BinaryWire::TopicById) {
+            const TopicRegistry& topics = TopicRegistry::instance();
+            const quint64 epoch = r.varint();
+            const quint64 ref = r.varint();
+            if (r.ok && (ref & 1) && epoch == topics.epoch()) {
+                v.topic_id = TopicId(ref >> 1);
+                v.topic = topics.name(v.topic_id);
+            }
+            if (v.topic.isEmpty()) {
+                // Encoded against a table this process does not have (we restarted)
+                qWarning() << "[DROP][DECODE] binary envelope: stale topic id" << (ref >> 1) << "epoch" << epoch;
+                return std::nullopt;
+            }
+        } else {
+            v.topic = r.ref();
+        }
+        v.publisher_id = r.ref();
+        v.filtered = flags & BinaryWire::Filtered;
+        switch (flags & BinaryWire::QosMask) {
+        case BinaryWire::QosReliable: v.qos = QStringLiteral("reliable"); break;
+        case BinaryWire::QosReliableNack: v.qos = QStringLiteral("reliable_nack"); break;
+        default: v.qos = QStringLiteral("best_effort"); break;
+        }
+        const quint64 len = r.varint();
+        if (r.ok && len <= quint64(r.end - r.p)) {
+            v.payload_offset = int(r.p - base);
+            v.payload_size = int(len);
+        } else {
+            r.ok = false;
+        }
+    } else if (kind == BinaryWire::KindAck) {
+        v.type = PacketType::Ack;
+        v.receiver_id = r.ref();
+        v.status = r.ref();
+    }
+    if (v.type == PacketType::Unknown || !r.ok) {
+        qWarning() << "[DROP][DECODE] binary envelope: truncated or unknown kind" << kind;
+        return std::nullopt;
+    }
+    return v;
+}
+
+std::optional<EnvelopeView> viewFromJson(const QByteArray& bytes) {
+    PacketType pt = PacketType::Unknown;
+    auto parsed = Serializer::decodeJSON(bytes, &pt);
+    if (!parsed) return std::nullopt;
+    const QJsonObject& o = *parsed;
+    EnvelopeView v;
+    v.type = pt;
+    v.format = WireFormat::Json;
+    v.raw = bytes;
+    v.topic = o.value("topic").toString();
+    v.publisher_id = o.value("publisher_id").toString();
+    v.receiver_id = o.value("receiver_node_id").toString();
+    v.qos = o.value("qos").toString();
+    v.message_id = o.value("message_id").toVariant().toLongLong();
+    v.timestamp = o.value("timestamp").toVariant().toLongLong();
+    v.seq = quint64(o.value("seq").toVariant().toLongLong());
+    v.incarnation = quint32(o.value("incarnation").toVariant().toLongLong());
+    v.filtered = o.value("filtered").toBool();
+    v.cum_seq = quint64(o.value("cum_seq").toVariant().toLongLong());
+    v.sack_bits = quint32(o.value("sack_bits").toVariant().toLongLong());
+    v.first_seq = quint64(o.value("first_seq").toVariant().toLongLong());
+    v.json_payload = o.value("payload").toObject();
+    return v;
+}
+
+} // namespace
+
+std::optional<QJsonObject> Serializer::decodeBinary(const QByteArray& bytes, PacketType* outType) {
+    if (outType) *outType = PacketType::Unknown;
+    if (!isBinary(bytes)) {
+        qWarning() << "[DROP][DECODE] binary envelope: bad magic";
+        return std::nullopt;
+    }
+    const auto v = viewFromBinary(bytes);
+    if (!v) return std::nullopt;
+
+    QJsonObject o;
+    if (v->type == PacketType::Sack || v->type == PacketType::Nack || v->type == PacketType::Heartbeat) {
+        o["type"] = v->type == PacketType::Sack ? "sack" : v->type == PacketType::Nack ? "nack" : "heartbeat";
+        o["topic"] = v->topic;
+        o["publisher_id"] = v->publisher_id;
+        o["receiver_node_id"] = v->receiver_id;
+        o["cum_seq"] = qint64(v->cum_seq);
+        if (v->type == PacketType::Heartbeat) {
+            o["first_seq"] = qint64(v->first_seq);
+            if (!v->qos.isEmpty()) o["qos"] = v->qos;
+            if (v->incarnation) o["incarnation"] = qint64(v->incarnation);
+        } else {
+            o["sack_bits"] = qint64(v->sack_bits);
+        }
+        o["timestamp"] = v->timestamp;
+        if (outType) *outType = v->type;
+        return o;
+    }
+    o["message_id"] = v->message_id;
+    o["timestamp"] = v->timestamp;
+    if (v->seq) o["seq"] = qint64(v->seq);
+    if (v->incarnation) o["incarnation"] = qint64(v->incarnation);
+    if (v->filtered) o["filtered"] = true;
+    if (v->type == PacketType::Data) {
+        QCborParserError err;
+        const QCborValue payload = QCborValue::fromCbor(bytes.mid(v->payload_offset, v->payload_size), &err);
+        if (err.error != QCborError::NoError || !payload.isMap()) {
+            qWarning() << "[DROP][DECODE] binary envelope: bad payload:" << err.errorString();
             return std::nullopt;
         }
+        o["type"] = "data";
+        o["topic"] = v->topic;
+        o["publisher_id"] = v->publisher_id;
+        o["qos"] = v->qos;
+        o["payload"] = payload.toMap().toJsonObject();
+    } else {
+        o["type"] = "ack";
+        o["receiver_node_id"] = v->receiver_id;
+        o["status"] = v->status;
     }
+    if (outType) *outType = v->type;
     return o;
 }
 
+QJsonObject EnvelopeView::payload() const {
+    if (format == WireFormat::Json || payload_offset < 0) return json_payload;
+    const QByteArray encoded = QByteArray::fromRawData(raw.constData() + payload_offset, payload_size);
+    return QCborValue::fromCbor(encoded).toMap().toJsonObject();
+}
+
+MessageEnvelope EnvelopeView::toEnvelope() const {
+    MessageEnvelope m;
+    m.topic = topic;
+    m.message_id = message_id;
+    m.payload = payload();
+    m.timestamp = timestamp;
+    m.qos = qos;
+    m.publisher_id = publisher_id;
+    m.seq = seq;
+    m.incarnation = incarnation;
+    m.filtered = filtered;
+    return m;
+}
+
+std::optional<EnvelopeView> Serializer::decodeEnvelopeView(const QByteArray& bytes) {
+    switch (detectFormat(bytes)) {
+    case WireFormat::Binary: return viewFromBinary(bytes);
+    case WireFormat::Cbor:   return viewFromCbor(bytes);
+    case WireFormat::Json:   return viewFromJson(bytes);
+    case WireFormat::Unknown: break;
+    }
+    qWarning() << "[DROP][DECODE] unrecognised packet format, len=" << bytes.size();
+    return std::nullopt;
+}
+
 // Polymorphic encode/decode
 QByteArray Serializer::encodeEnvelope(const MessageEnvelope& m, const QString& fmt) {
     if (fmt == "cbor") {
         return encodeDataCBOR(m);
+    } else if (fmt == "bin") {
+        return encodeDataBinary(m);
     } else {
         return encodeData(m);
     }
 }
 
 std::optional<MessageEnvelope> Serializer::decodeEnvelope(const QByteArray& bytes, const QString& fmt) {
-    if (fmt == "cbor") {
+    if (fmt == "cbor" || fmt == "bin") {
         PacketType t = PacketType::Unknown;
-        auto parsed = decodeCBOR(bytes, &t);
+        auto parsed = fmt == "bin" ? decodeBinary(bytes, &t) : decodeCBOR(bytes, &t);
         if (!parsed || t != PacketType::Data) return std::nullopt;
         auto o = *parsed;
         MessageEnvelope m;
@@ -293,6 +791,8 @@ std::optional<MessageEnvelope> Serializer::decodeEnvelope(const QByteArray& byte
         m.timestamp = o.value("timestamp").toVariant().toLongLong();
         m.qos = o.value("qos").toString();
         m.publisher_id = o.value("publisher_id").toString();
+        m.seq = quint64(o.value("seq").toVariant().toLongLong());
+        m.incarnation = quint32(o.value("incarnation").toVariant().toLongLong());
         return m;
     } else {
         PacketType t = PacketType::Unknown;
@@ -306,13 +806,17 @@ std::optional<MessageEnvelope> Serializer::decodeEnvelope(const QByteArray& byte
         m.timestamp = o.value("timestamp").toVariant().toLongLong();
         m.qos = o.value("qos").toString();
         m.publisher_id = o.value("publisher_id").toString();
+        m.seq = quint64(o.value("seq").toVariant().toLongLong());
+        m.incarnation = quint32(o.value("incarnation").toVariant().toLongLong());
         return m;
     }
 }
 
+// Both formats carry the same fields: the CBOR map is the JSON object as
+// CBOR, so topic ids, content filters and qos modes survive either way.
 QByteArray Serializer::encodeDiscovery(const DiscoveryPacket& pkt, const QString& fmt) {
     if (fmt == "cbor") {
-        return encodeDiscoveryCBOR(pkt.node_id, pkt.topics, pkt.protocol_version, pkt.timestamp, pkt.data_port, pkt.serialization);
+        return QCborMap::fromJsonObject(to_json(pkt)).toCborValue().toCbor();
     } else {
         return QJsonDocument(to_json(pkt)).toJson(QJsonDocument::Compact);
     }
@@ -323,33 +827,7 @@ std::optional<DiscoveryPacket> Serializer::decodeDiscovery(const QByteArray& byt
         PacketType t = PacketType::Unknown;
         auto parsed = decodeCBOR(bytes, &t);
         if (!parsed || t != PacketType::Discovery) return std::nullopt;
-        auto o = *parsed;
-        DiscoveryPacket pkt;
-        pkt.node_id = o.value("node_id").toString();
-        pkt.protocol_version = o.value("protocol_version").toString();
-        pkt.timestamp = o.value("timestamp").toVariant().toLongLong();
-        pkt.data_port = static_cast<quint16>(o.value("data_port").toInt());
-        pkt.udp_port = static_cast<quint16>(o.value("udp_port").toInt());
-        pkt.tcp_port = static_cast<quint16>(o.value("tcp_port").toInt());
-        // Topics
-        const QJsonValue& topicsVal = o.value("topics");
-        if (topicsVal.isArray()) {
-            QJsonArray arr = topicsVal.toArray();
-            for (const QJsonValue& v : arr) {
-                if (v.isString()) pkt.topics << v.toString();
-            }
-        }
-        // Serialization
-        if (o.contains("serialization")) {
-            const QJsonValue& serVal = o.value("serialization");
-            if (serVal.isArray()) {
-                QJsonArray arr = serVal.toArray();
-                for (const QJsonValue& v : arr) {
-                    if (v.isString()) pkt.serialization << v.toString();
-                }
-            }
-        }
-        return pkt;
+        return from_json(*parsed);
     } else {
         QJsonParseError err{};
         QJsonDocument doc = QJsonDocument::fromJson(bytes, &err);
@@ -361,15 +839,17 @@ std::optional<DiscoveryPacket> Serializer::decodeDiscovery(const QByteArray& byt
 QByteArray Serializer::encodeAck(qint64 messageId, const QString& receiverId, const QString& status, qint64 ts, const QString& fmt) {
     if (fmt == "cbor") {
         return encodeAckCBOR(messageId, receiverId, status, ts);
+    } else if (fmt == "bin") {
+        return encodeAckBinary(messageId, receiverId, status, ts);
     } else {
         return encodeAck(messageId, receiverId, status, ts);
     }
 }
 
 std::optional<QJsonObject> Serializer::decodeAck(const QByteArray& bytes, const QString& fmt) {
-    if (fmt == "cbor") {
+    if (fmt == "cbor" || fmt == "bin") {
         PacketType t = PacketType::Unknown;
-        auto parsed = decodeCBOR(bytes, &t);
+        auto parsed = fmt == "bin" ? decodeBinary(bytes, &t) : decodeCBOR(bytes, &t);
         if (!parsed || t != PacketType::Ack) return std::nullopt;
         return *parsed;
     } else {
@@ -393,6 +873,21 @@ QJsonObject Serializer::to_json(const DiscoveryPacket& pkt) {
         o["udp_port"] = int(pkt.udp_port);
     if (pkt.tcp_port > 0)
         o["tcp_port"] = int(pkt.tcp_port);
+    if (!pkt.qos_modes.isEmpty())
+        o["qos_modes"] = QJsonArray::fromStringList(pkt.qos_modes);
+    if (pkt.topic_epoch && !pkt.topic_ids.isEmpty()) {
+        QJsonObject ids;
+        for (auto it = pkt.topic_ids.constBegin(); it != pkt.topic_ids.constEnd(); ++it) ids[it.key()] = qint64(it.value());
+        o["topic_ids"] = ids;
+        o["topic_epoch"] = qint64(pkt.topic_epoch);
+    }
+    if (!pkt.content_filters.isEmpty()) {
+        QJsonObject filters;
+        for (auto it = pkt.content_filters.constBegin(); it != pkt.content_filters.constEnd(); ++it) {
+            filters[it.key()] = QJsonArray::fromStringList(it.value());
+        }
+        o["content_filters"] = filters;
+    }
     return o;
 }
 
@@ -428,5 +923,22 @@ std::optional<DiscoveryPacket> Serializer::from_json(const QJsonObject& o) {
             }
         }
     }
+    for (const QJsonValue& v : o.value("qos_modes").toArray()) {
+        if (v.isString()) pkt.qos_modes << v.toString();
+    }
+    const QJsonObject ids = o.value("topic_ids").toObject();
+    for (auto it = ids.constBegin(); it != ids.constEnd(); ++it) {
+        const qint64 id = it.value().toVariant().toLongLong();
+        if (id > 0 && id <= 0xFFFFFFFFLL) pkt.topic_ids.insert(it.key(), quint32(id));
+    }
+    pkt.topic_epoch = quint32(o.value("topic_epoch").toVariant().toLongLong());
+    const QJsonObject filters = o.value("content_filters").toObject();
+    for (auto it = filters.constBegin(); it != filters.constEnd(); ++it) {
+        QStringList exprs;
+        for (const QJsonValue& v : it.value().toArray()) {
+            if (v.isString()) exprs << v.toString();
+        }
+        if (!exprs.isEmpty()) pkt.content_filters.insert(it.key(), exprs);
+    }
     return pkt;
 }
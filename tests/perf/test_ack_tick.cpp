@@ -0,0 +1,112 @@
+#include <QTest>
+#include <QDateTime>
+#include <QHash>
+#include <QStringList>
+#include "transport/ack_manager.h"
+#include "flat_u64_map.h"
+
+// Cost of one AckManager tick against the number of reliable messages in flight
+// (nothing is due in the measured tick, which is the common case) and of the
+// per-packet track/ACK path. Run manually; QBENCHMARK reports time per iteration.
+static constexpr qint64 AckManagerTickStep = 10;
+
+class TestAckTick : public QObject {
+    Q_OBJECT
+
+private slots:
+    void tick_data() {
+        QTest::addColumn<int>("inFlight");
+        QTest::newRow("1k") << 1000;
+        QTest::newRow("10k") << 10000;
+        QTest::newRow("100k") << 100000;
+    }
+
+    void tick() {
+        QFETCH(int, inFlight);
+
+        AckManager ack;
+        const qint64 start = QDateTime::currentMSecsSinceEpoch();
+        const QByteArray packet(256, 'x');
+        for (int i = 0; i < inFlight; ++i) {
+            Pending p;
+            p.packet = packet;
+            p.retries_left = 3;
+            // A minute out, spread over four seconds: every wheel slot holds entries
+            // for a later rotation, which is the worst case a non-expiring tick sees
+            p.deadline_ms = start + 60000 + (i % 4000);
+            p.base_timeout_ms = 1000;
+            p.msg_id = i;
+            p.receiver_id = QStringLiteral("peer-%1").arg(i % 8);
+            ack.track(p);
+        }
+
+        qint64 now = start;
+        QBENCHMARK {
+            ack.processTimeouts(now);
+            now += AckManagerTickStep; // one wheel slot per tick, no deadline reached
+        }
+        QCOMPARE(ack.pendingCount(), inFlight);
+    }
+
+    // One reliable send to and ACK from each of eight peers
+    void trackAndAck() {
+        AckManager ack;
+        const qint64 deadline = QDateTime::currentMSecsSinceEpoch() + 60000;
+        const QByteArray packet(256, 'x');
+        QStringList peers;
+        for (int r = 0; r < 8; ++r) peers << QStringLiteral("peer-%1").arg(r);
+        qint64 mid = 0;
+        QBENCHMARK {
+            ++mid;
+            for (const QString& peer : peers) {
+                Pending p;
+                p.packet = packet;
+                p.deadline_ms = deadline;
+                p.msg_id = mid;
+                p.receiver_id = peer;
+                ack.track(p);
+            }
+            for (const QString& peer : peers) ack.ackReceived(mid, peer);
+        }
+        QVERIFY(!ack.hasPending());
+    }
+
+    void flatMapMatchesQHash() {
+        FlatU64Map<int> flat;
+        QHash<quint64, int> ref;
+        quint64 x = 88172645463325252ULL;
+        for (int i = 0; i < 200000; ++i) {
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17; // xorshift64
+            const quint64 key = x % 4096;             // dense keys force long probe runs
+            if (x & 1) { flat.insert(key, i); ref.insert(key, i); }
+            else { QCOMPARE(flat.erase(key), ref.remove(key) > 0); }
+        }
+        QCOMPARE(flat.size(), int(ref.size()));
+        for (auto it = ref.cbegin(); it != ref.cend(); ++it) {
+            const int* v = flat.find(it.key());
+            QVERIFY(v);
+            QCOMPARE(*v, it.value());
+        }
+    }
+
+    void expiresOnlyDue() {
+        AckManager ack;
+        const qint64 start = QDateTime::currentMSecsSinceEpoch();
+        for (int i = 0; i < 100; ++i) {
+            Pending p;
+            p.packet = "x";
+            p.retries_left = 0;
+            p.deadline_ms = start + i * 100;
+            p.msg_id = i;
+            p.receiver_id = "peer";
+            ack.track(p);
+        }
+        ack.processTimeouts(start + 4950);
+        QCOMPARE(ack.pendingCount(), 50);
+        ack.processTimeouts(start + 20000); // beyond a full wheel rotation
+        QCOMPARE(ack.pendingCount(), 0);
+    }
+};
+
+QTEST_MAIN(TestAckTick)
+#include "test_ack_tick.moc"
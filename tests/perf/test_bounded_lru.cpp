@@ -0,0 +1,127 @@
+#include <QTest>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include "bounded_lru.h"
+
+// BoundedLRU against the QList + QSet<QString> version it replaced, on the
+// dedup workload that version served: a stream of fresh "publisher:topic:mid"
+// keys with a few repeats. Run manually; QBENCHMARK reports the time per
+// iteration (1000 inserts).
+namespace {
+
+class LegacyBoundedLRU {
+public:
+    explicit LegacyBoundedLRU(int capacity) : cap(capacity) {}
+    bool contains(const QString& key) const { return set.contains(key); }
+    void insert(const QString& key) {
+        if (set.contains(key)) return;
+        if (order.size() >= cap) {
+            QString oldest = order.takeFirst();
+            set.remove(oldest);
+        }
+        order.append(key);
+        set.insert(key);
+    }
+private:
+    int cap;
+    QList<QString> order;
+    QSet<QString> set;
+};
+
+constexpr int kBatch = 1000;
+
+QVector<QString> streamKeys(int n) {
+    QVector<QString> keys;
+    keys.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        // Every eighth key repeats a recent one, like a retransmit
+        const int mid = (i % 8 == 7) ? i - 5 : i;
+        keys << QStringLiteral("dds-node-%1:sensor/temperature:%2").arg(mid % 4).arg(mid);
+    }
+    return keys;
+}
+
+} // namespace
+
+class TestBoundedLru : public QObject {
+    Q_OBJECT
+
+private slots:
+    void insert_data() {
+        QTest::addColumn<int>("impl");
+        QTest::addColumn<int>("capacity");
+        for (int cap : {2048, 65536}) {
+            QTest::newRow(qPrintable(QStringLiteral("legacy/%1").arg(cap))) << 0 << cap;
+            QTest::newRow(qPrintable(QStringLiteral("string/%1").arg(cap))) << 1 << cap;
+            QTest::newRow(qPrintable(QStringLiteral("hashed64/%1").arg(cap))) << 2 << cap;
+        }
+    }
+
+    void insert() {
+        QFETCH(int, impl);
+        QFETCH(int, capacity);
+        // Keys are built up front: the loop measures the structure, not string
+        // formatting. The hashed variant still hashes each key in the loop.
+        const QVector<QString> keys = streamKeys(capacity * 4);
+        LegacyBoundedLRU legacy(capacity);
+        BoundedLRU<QString> byString(capacity);
+        BoundedLRU<quint64> byHash(capacity);
+        int next = 0;
+        int fresh = 0;
+        QBENCHMARK {
+            for (int i = 0; i < kBatch; ++i) {
+                const QString& key = keys[next];
+                next = next + 1 == keys.size() ? 0 : next + 1;
+                switch (impl) {
+                case 0:
+                    if (!legacy.contains(key)) { legacy.insert(key); ++fresh; }
+                    break;
+                case 1:
+                    fresh += byString.insert(key);
+                    break;
+                default:
+                    fresh += byHash.insert(lruKey64(key));
+                    break;
+                }
+            }
+        }
+        QVERIFY(fresh > 0);
+    }
+
+    // Insert-only use keeps the legacy eviction order exactly
+    void matchesLegacy() {
+        const QVector<QString> keys = streamKeys(20000);
+        LegacyBoundedLRU legacy(512);
+        BoundedLRU<QString> lru(512);
+        for (const QString& k : keys) {
+            QCOMPARE(lru.contains(k), legacy.contains(k));
+            legacy.insert(k);
+            lru.insert(k);
+        }
+        for (const QString& k : keys) QCOMPARE(lru.contains(k), legacy.contains(k));
+        QCOMPARE(lru.size(), 512);
+    }
+
+    void touchAndRemove() {
+        BoundedLRU<quint64> lru(3);
+        QVERIFY(lru.insert(1));
+        QVERIFY(lru.insert(2));
+        QVERIFY(lru.insert(3));
+        QVERIFY(!lru.insert(1));     // present: order unchanged
+        QVERIFY(lru.touch(1));       // now 2 is the oldest
+        QVERIFY(lru.insert(4));
+        QVERIFY(!lru.contains(2));
+        QCOMPARE(lru.oldest(), quint64(3));
+        QVERIFY(lru.remove(3));
+        QVERIFY(!lru.remove(3));
+        QCOMPARE(lru.size(), 2);
+        QVERIFY(lru.insert(5));      // reuses the freed node, no eviction
+        QVERIFY(lru.contains(1) && lru.contains(4) && lru.contains(5));
+        QCOMPARE(lru.oldest(), quint64(1));
+    }
+};
+
+QTEST_MAIN(TestBoundedLru)
+#include "test_bounded_lru.moc"
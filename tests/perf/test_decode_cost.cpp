@@ -0,0 +1,52 @@
+#include <QTest>
+#include <QJsonObject>
+#include "serialization/serializer.h"
+
+// Per-packet decode cost of Serializer::decode for each wire format.
+// Run manually; QBENCHMARK reports the time per iteration (one datagram).
+class TestDecodeCost : public QObject {
+    Q_OBJECT
+
+private:
+    static MessageEnvelope sample() {
+        QJsonObject payload{{"value", 23.5}, {"unit", "C"}, {"sensor", "t-01"}};
+        return MessageEnvelope{"sensor/temperature", 123456, payload, 1234567890, "reliable", "dds-node-1"};
+    }
+
+private slots:
+    void decode_data() {
+        QTest::addColumn<QByteArray>("packet");
+        QTest::addColumn<int>("expectedType");
+
+        const MessageEnvelope m = sample();
+        QTest::newRow("data/json") << Serializer::encodeEnvelope(m, "json") << int(PacketType::Data);
+        QTest::newRow("data/cbor") << Serializer::encodeEnvelope(m, "cbor") << int(PacketType::Data);
+        QTest::newRow("data/bin")  << Serializer::encodeEnvelope(m, "bin")  << int(PacketType::Data);
+        QTest::newRow("ack/json")  << Serializer::encodeAck(123456, "dds-node-2", "ACK", 1234567890, "json") << int(PacketType::Ack);
+        QTest::newRow("ack/cbor")  << Serializer::encodeAck(123456, "dds-node-2", "ACK", 1234567890, "cbor") << int(PacketType::Ack);
+        QTest::newRow("ack/bin")   << Serializer::encodeAck(123456, "dds-node-2", "ACK", 1234567890, "bin")  << int(PacketType::Ack);
+    }
+
+    void decode() {
+        QFETCH(QByteArray, packet);
+        QFETCH(int, expectedType);
+
+        PacketType t = PacketType::Unknown;
+        QBENCHMARK {
+            auto parsed = Serializer::decode(packet, &t);
+            Q_UNUSED(parsed);
+        }
+        QCOMPARE(int(t), expectedType);
+    }
+
+    void detectFormat() {
+        QCOMPARE(Serializer::detectFormat(Serializer::encodeEnvelope(sample(), "json")), WireFormat::Json);
+        QCOMPARE(Serializer::detectFormat(Serializer::encodeEnvelope(sample(), "cbor")), WireFormat::Cbor);
+        QCOMPARE(Serializer::detectFormat(Serializer::encodeEnvelope(sample(), "bin")), WireFormat::Binary);
+        QCOMPARE(Serializer::detectFormat(QByteArray(" \n{\"type\":\"ack\"}")), WireFormat::Json);
+        QCOMPARE(Serializer::detectFormat(QByteArray("not json")), WireFormat::Unknown);
+    }
+};
+
+QTEST_MAIN(TestDecodeCost)
+#include "test_decode_cost.moc"
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QVector>
+#include "serializer.h"
+#include "transport_base.h"
+
+// In-memory transport for core tests: records every datagram handed to it
+// (sendBatch falls back to send()) and every multicast join/leave; nothing
+// reaches the network.
+class CaptureTransport : public ITransport {
+public:
+    CaptureTransport() : ITransport(nullptr) {}
+
+    bool send(const QByteArray& datagram, const QHostAddress& to, quint16 port) override {
+        sent.append(OutDatagram{datagram, to, port});
+        return true;
+    }
+    quint16 boundPort() const override { return 12345; }
+    void stop() override {}
+    bool joinGroup(const QHostAddress& group) override { joined << group; return true; }
+    void leaveGroup(const QHostAddress& group) override { left << group; }
+
+    QVector<quint16> ports() const {
+        QVector<quint16> out;
+        for (const OutDatagram& d : sent) out << d.port;
+        return out;
+    }
+
+    // Data packets only, without the stream control (heartbeats, SACKs) around them
+    QVector<OutDatagram> samples() const {
+        QVector<OutDatagram> out;
+        for (const OutDatagram& d : sent) {
+            const auto v = Serializer::decodeEnvelopeView(d.bytes);
+            if (v && v->type == PacketType::Data) out << d;
+        }
+        return out;
+    }
+    QVector<quint16> samplePorts() const {
+        QVector<quint16> out;
+        for (const OutDatagram& d : samples()) out << d.port;
+        return out;
+    }
+
+    QVector<OutDatagram> sent;
+    QVector<QHostAddress> joined;
+    QVector<QHostAddress> left;
+};
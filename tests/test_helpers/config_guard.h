@@ -0,0 +1,44 @@
+#pragma once
+
+#include "config_manager.h"
+
+// Snapshot of the process-wide ConfigManager settings, put back on
+// destruction. Suites hold one from init() to cleanup(), so whatever a test
+// changes never leaks into the next one.
+class ConfigGuard {
+public:
+    ConfigGuard() {
+        const ConfigManager& c = ConfigManager::ref();
+        node_id = c.node_id;
+        protocol_version = c.protocol_version;
+        disc = c.disc;
+        transport = c.transport;
+        qos_cfg = c.qos_cfg;
+        serialization = c.serialization;
+        logging = c.logging;
+        topics_list = c.topics_list;
+    }
+    ~ConfigGuard() {
+        ConfigManager& c = ConfigManager::ref();
+        c.node_id = node_id;
+        c.protocol_version = protocol_version;
+        c.disc = disc;
+        c.transport = transport;
+        c.qos_cfg = qos_cfg;
+        c.serialization = serialization;
+        c.logging = logging;
+        c.topics_list = topics_list;
+    }
+    ConfigGuard(const ConfigGuard&) = delete;
+    ConfigGuard& operator=(const ConfigGuard&) = delete;
+
+private:
+    QString node_id;
+    QString protocol_version;
+    DiscoveryConfig disc;
+    TransportConfig transport;
+    QosConfig qos_cfg;
+    SerializationConfig serialization;
+    LoggingConfig logging;
+    QStringList topics_list;
+};
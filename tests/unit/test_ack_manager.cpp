@@ -1,4 +1,5 @@
 #include <QTest>
+#include <optional>
 #include <QSignalSpy>
 #include <QTemporaryDir>
 #include <QJsonDocument>
@@ -7,11 +8,17 @@
 #include "dds_core.h"
 #include "publisher.h"
 #include "config_manager.h"
+#include "tests/test_helpers/config_guard.h"
+
+static constexpr qint64 AckManagerSlack = 20; // one wheel slot plus rounding
 
 class TestAckManager : public QObject {
     Q_OBJECT
 
 private slots:
+    void init() { config.emplace(); }
+    void cleanup() { config.reset(); }
+
     void testRetriesThenGiveup() {
         AckManager ack;
         QSignalSpy resendSpy(&ack, &AckManager::resend);
@@ -40,6 +47,179 @@ private slots:
         QCOMPARE(failedSpy.at(0).at(1).toString(), receiverId);
     }
 
+    void testDueResendsBatchedPerTick() {
+        AckManager ack;
+        QSignalSpy batchSpy(&ack, &AckManager::resendBatch);
+
+        const qint64 due = QDateTime::currentMSecsSinceEpoch() - 1;
+        for (int i = 0; i < 3; ++i) {
+            Pending p;
+            p.packet = "dummy";
+            p.retries_left = 1;
+            p.deadline_ms = due;
+            p.base_timeout_ms = 1000;
+            p.msg_id = 100 + i;
+            p.receiver_id = "peer-1";
+            ack.track(p);
+        }
+
+        QTRY_COMPARE_WITH_TIMEOUT(batchSpy.count(), 1, 1000);
+        QCOMPARE(batchSpy.at(0).at(0).value<QVector<Pending>>().size(), 3);
+    }
+
+    void testAdaptiveRtoFromSamples() {
+        ConfigManager::ref().qos_cfg.reliable.adaptive_rto = true;
+        AckManager ack;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QVERIFY(!ack.rttFor("peer-rtt").has_value());
+
+        Pending p;
+        p.packet = "dummy";
+        p.retries_left = 3;
+        p.deadline_ms = now + 10000;
+        p.base_timeout_ms = 10000;
+        p.msg_id = 1;
+        p.receiver_id = "peer-rtt";
+        p.sent_ms = now - 40;
+        ack.track(p);
+        ack.ackReceived(1, "peer-rtt");
+
+        auto est = ack.rttFor("peer-rtt");
+        QVERIFY(est.has_value());
+        QCOMPARE(est->samples, 1);
+        QVERIFY(est->srtt_ms >= 40);
+        // First sample: RTO = srtt + 4 * srtt/2, well under the configured 10 s
+        QVERIFY(est->rto_ms >= 120 && est->rto_ms < 1000);
+
+        // Karn: an ACK for a retransmission does not update the estimate
+        p.msg_id = 2;
+        p.attempt = 1;
+        p.sent_ms = now - 900;
+        ack.track(p);
+        ack.ackReceived(2, "peer-rtt");
+        QCOMPARE(ack.rttFor("peer-rtt")->samples, 1);
+
+        // New sends to this peer use the measured RTO instead of the fixed timeout
+        QSignalSpy resendSpy(&ack, &AckManager::resend);
+        p.msg_id = 3;
+        p.attempt = 0;
+        p.sent_ms = now;
+        ack.track(p);
+        ack.processTimeouts(now + est->rto_ms + AckManagerSlack);
+        QCOMPARE(resendSpy.count(), 1);
+        QCOMPARE(ack.rttEstimates().size(), 1);
+    }
+
+    void testRangeAckRetiresStream() {
+        AckManager ack;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (quint64 seq = 1; seq <= 40; ++seq) {
+            Pending p;
+            p.packet = "dummy";
+            p.retries_left = 3;
+            p.deadline_ms = now + 10000;
+            p.msg_id = qint64(1000 + seq);
+            p.receiver_id = "peer-s";
+            p.topic = "stream/t";
+            p.topic_id = 7;
+            p.seq = seq;
+            ack.track(p);
+        }
+        // cum 30, plus 32 and 40 selectively
+        const quint32 bits = (1u << 1) | (1u << 9);
+        QCOMPARE(int(ack.ackRange("peer-s", 7, 30, bits).size()), 32);
+        QCOMPARE(ack.pendingCount(), 8);
+        QVERIFY(ack.ackRange("peer-s", 7, 30, bits).isEmpty()); // repeat is harmless
+        QVERIFY(ack.ackRange("peer-s", 8, 40, 0).isEmpty());
+        QCOMPARE(int(ack.ackRange("peer-s", 7, 40, 0).size()), 8);
+        QVERIFY(!ack.hasPending());
+    }
+
+    void testReleasedReceiverSlotIsReused() {
+        AckManager ack;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        auto message = [&](const QString& receiver, qint64 mid) {
+            Pending p;
+            p.packet = "dummy";
+            p.retries_left = 3;
+            p.deadline_ms = now + 10000;
+            p.msg_id = mid;
+            p.receiver_id = receiver;
+            p.topic = "slot/t";
+            p.topic_id = 3;
+            p.seq = quint64(mid);
+            return p;
+        };
+        ack.track(message("gone", 1));
+        ack.releaseReceiver("gone");                  // expired with a message in flight
+        QCOMPARE(ack.receiverCount(), 1);
+        QCOMPARE(int(ack.ackRange("gone", 3, 1, 0).size()), 1); // a late ACK still retires it
+        QCOMPARE(ack.receiverCount(), 0);             // then the slot is free
+        QVERIFY(!ack.rttFor("gone"));
+
+        ack.track(message("next", 2));
+        QCOMPARE(ack.receiverCount(), 1);
+        QVERIFY(ack.ackRange("gone", 3, 2, 0).isEmpty()); // the reused slot is not the old receiver's
+        QCOMPARE(ack.oldestSeq("next", 3), quint64(2));
+        QCOMPARE(int(ack.ackRange("next", 3, 2, 0).size()), 1);
+        QCOMPARE(ack.oldestSeq("next", 3), quint64(0));
+
+        // A receiver that comes back before its slot is reclaimed keeps it
+        ack.track(message("next", 3));
+        ack.releaseReceiver("next");
+        ack.track(message("next", 4));
+        QCOMPARE(int(ack.ackRange("next", 3, 4, 0).size()), 2);
+        QCOMPARE(ack.receiverCount(), 1);
+    }
+
+    void testSendWindowQueuesAndAdapts() {
+        auto& rel = ConfigManager::ref().qos_cfg.reliable;
+        rel.window_initial = 4;
+        rel.max_in_flight = 64;
+        rel.max_queue = 3;
+        AckManager ack;
+        QSignalSpy dispatchSpy(&ack, &AckManager::dispatch);
+        QSignalSpy pressureSpy(&ack, &AckManager::backpressure);
+        QSignalSpy failedSpy(&ack, &AckManager::failed);
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        auto make = [&](qint64 mid) {
+            Pending p;
+            p.packet = "dummy";
+            p.retries_left = 3;
+            p.deadline_ms = now + 100;
+            p.base_timeout_ms = 100;
+            p.exponential_backoff = false;
+            p.msg_id = mid;
+            p.receiver_id = "peer-w";
+            return p;
+        };
+        for (qint64 mid = 1; mid <= 4; ++mid) QVERIFY(ack.submit(make(mid)));
+        QVERIFY(!ack.submit(make(5)));                 // window full: queued
+        QCOMPARE(pressureSpy.count(), 1);
+        QVERIFY(pressureSpy.at(0).at(1).toBool());
+        QVERIFY(!ack.submit(make(6)));
+        QVERIFY(!ack.submit(make(7)));
+        QVERIFY(!ack.submit(make(8)));                 // queue bound: mid 5 is dead-lettered
+        QCOMPARE(failedSpy.count(), 1);
+        QCOMPARE(failedSpy.at(0).at(0).toLongLong(), qint64(5));
+        QCOMPARE(ack.pendingCount(), 4);
+        QCOMPARE(ack.queuedFor("peer-w"), 3);
+
+        ack.ackReceived(1, "peer-w");                  // one slot frees, window grows by 1/4
+        QCOMPARE(dispatchSpy.count(), 1);
+        const auto ready = dispatchSpy.at(0).at(0).value<QVector<Pending>>();
+        QCOMPARE(ready.size(), 1);
+        QCOMPARE(ready.first().msg_id, qint64(6));
+        QCOMPARE(ack.pendingCount(), 4);
+
+        ack.processTimeouts(now + 100 + AckManagerSlack); // whole window times out: halve once
+        QCOMPARE(ack.windowFor("peer-w"), 2);
+        for (qint64 mid = 2; mid <= 6; ++mid) ack.ackReceived(mid, "peer-w");
+        QCOMPARE(ack.queuedCount(), 0);                // 7 and 8 went out as the window reopened
+        QCOMPARE(pressureSpy.count(), 2);
+        QVERIFY(!pressureSpy.at(1).at(1).toBool());
+    }
+
     void testAckBeforeGiveup() {
         AckManager ack;
         QSignalSpy resendSpy(&ack, &AckManager::resend);
@@ -154,7 +334,8 @@ private slots:
         QCOMPARE(dlSpy.at(0).at(1).toString(), receiverId);
         QCOMPARE(dlSpy.at(0).at(2).toInt(), 2); // attempts
 
-        // Check NDJSON file
+        // Check NDJSON file once the writer thread caught up
+        ack.flushDeadLetters();
         QFile f(deadletterPath);
         QVERIFY(f.open(QIODevice::ReadOnly | QIODevice::Text));
         QByteArray data = f.readAll();
@@ -177,6 +358,51 @@ private slots:
         QVERIFY(obj.contains("ts"));
     }
 
+    void testDeadLetterSidecar() {
+        QTemporaryDir tempDir;
+        QVERIFY(tempDir.isValid());
+        ConfigManager& cfg = ConfigManager::ref();
+        cfg.logging.deadletter_file = tempDir.filePath("dl.ndjson");
+        cfg.logging.deadletter_packets = true;
+
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        {
+            AckManager ack;
+            for (int i = 0; i < 500; ++i) {
+                Pending p;
+                p.packet = QByteArray("packet-") + QByteArray::number(i);
+                p.retries_left = 0;
+                p.deadline_ms = now - 1;
+                p.msg_id = 7000 + i;
+                p.receiver_id = "peer-gone";
+                ack.track(p);
+            }
+            ack.processTimeouts(now);
+            QVERIFY(!ack.hasPending());
+        } // destructor drains the writer
+
+        QFile log(cfg.logging.deadletter_file);
+        QFile sidecar(DeadLetterWriter::sidecarPathFor(cfg.logging.deadletter_file));
+        QVERIFY(log.open(QIODevice::ReadOnly | QIODevice::Text));
+        QVERIFY(sidecar.open(QIODevice::ReadOnly));
+        const QByteArray bytes = sidecar.readAll();
+        const QList<QByteArray> lines = log.readAll().split('\n');
+        int checked = 0;
+        for (const QByteArray& line : lines) {
+            if (line.isEmpty()) continue;
+            const QJsonObject o = QJsonDocument::fromJson(line).object();
+            const int offset = o.value("packet_offset").toInt(-1);
+            const int size = o.value("packet_size").toInt();
+            QVERIFY(offset >= 0 && offset + size <= bytes.size());
+            QCOMPARE(bytes.mid(offset, size), QByteArray("packet-") + QByteArray::number(o.value("message_id").toInt() - 7000));
+            ++checked;
+        }
+        QCOMPARE(checked, 500);
+        const auto records = DeadLetterWriter::readAll(cfg.logging.deadletter_file);
+        QCOMPARE(records.size(), 500);
+        QCOMPARE(records.last().packet, QByteArray("packet-499"));
+    }
+
     void testRetainLast() {
         // Create DDSCore with retain_last enabled
         ConfigManager& cfg = ConfigManager::ref();
@@ -229,6 +455,9 @@ private slots:
         QCOMPARE(receivedPayload.value("value").toDouble(), 42.0);
         QCOMPARE(receivedPayload.value("unit").toString(), QString("C"));
     }
+
+private:
+    std::optional<ConfigGuard> config; // each test starts from the same settings
 };
 
 QTEST_MAIN(TestAckManager)
@@ -0,0 +1,52 @@
+#include <QTest>
+#include <QJsonObject>
+#include "content_filter.h"
+
+class TestContentFilter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testComparisons() {
+        auto hot = ContentFilter::compile("value > 30 AND unit = 'C'");
+        QVERIFY(hot.has_value());
+        QCOMPARE(hot->expression(), QString("value > 30 AND unit = 'C'"));
+        QVERIFY(hot->matches(QJsonObject{{"value", 31}, {"unit", "C"}}));
+        QVERIFY(!hot->matches(QJsonObject{{"value", 31}, {"unit", "F"}}));
+        QVERIFY(!hot->matches(QJsonObject{{"value", "31"}, {"unit", "C"}})); // type mismatch
+        QVERIFY(!hot->matches(QJsonObject{{"unit", "C"}}));                  // missing field
+
+        auto quoted = ContentFilter::compile("name <> 'it''s'");
+        QVERIFY(quoted.has_value());
+        QVERIFY(!quoted->matches(QJsonObject{{"name", "it's"}}));
+        QVERIFY(quoted->matches(QJsonObject{{"name", "its"}}));
+    }
+
+    void testBooleanStructure() {
+        auto nested = ContentFilter::compile("not (pos.x <= 0 or ok = false)");
+        QVERIFY(nested.has_value());
+        QVERIFY(nested->matches(QJsonObject{{"pos", QJsonObject{{"x", 2}}}, {"ok", true}}));
+        QVERIFY(!nested->matches(QJsonObject{{"pos", QJsonObject{{"x", -1}}}, {"ok", true}}));
+        QVERIFY(!nested->matches(QJsonObject{{"pos", QJsonObject{{"x", 2}}}, {"ok", false}}));
+
+        // AND binds tighter than OR; keywords are whole words only
+        auto prec = ContentFilter::compile("a = 1 OR b = 1 AND ORDER = 2");
+        QVERIFY(prec.has_value());
+        QVERIFY(prec->matches(QJsonObject{{"a", 1}}));
+        QVERIFY(!prec->matches(QJsonObject{{"b", 1}}));
+        QVERIFY(prec->matches(QJsonObject{{"b", 1}, {"ORDER", 2}}));
+    }
+
+    void testSyntaxErrors() {
+        QString error;
+        QVERIFY(!ContentFilter::compile("value > ", &error).has_value());
+        QVERIFY(!error.isEmpty());
+        QVERIFY(!ContentFilter::compile("(value > 1").has_value());
+        QVERIFY(!ContentFilter::compile("value 1").has_value());
+        QVERIFY(!ContentFilter::compile("name = 'open").has_value());
+        QVERIFY(!ContentFilter::compile("   ").has_value());
+        QVERIFY(!ContentFilter::compile("a = 1 b = 2").has_value());
+    }
+};
+
+QTEST_MAIN(TestContentFilter)
+#include "test_content_filter.moc"
@@ -0,0 +1,196 @@
+#include <QTest>
+#include <optional>
+#include <QJsonObject>
+#include "dds_core.h"
+#include "config_manager.h"
+#include "tests/test_helpers/capture_transport.h"
+#include "tests/test_helpers/config_guard.h"
+
+// How DDSCore hands samples to local subscribers: fan-out, duplicate
+// filtering, intra-process delivery, wildcard and content-filtered
+// subscriptions.
+class TestDdsCoreDelivery : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init() { config.emplace(); }
+    void cleanup() { config.reset(); }
+
+    void testSubscribersFanOutAndUnsubscribe() {
+        CaptureTransport transport;
+        DDSCore core("fan-node", "1.0", &transport, nullptr);
+
+        QVector<QJsonObject> archiver, controller, monitor;
+        auto a = core.makeSubscriber("plant/state", [&](const QJsonObject& o) { archiver << o; });
+        auto c = core.makeSubscriber("plant/state", [&](const QJsonObject& o) { controller << o; });
+        auto m = core.makeSubscriber("plant/state", [&](const QJsonObject& o) { monitor << o; });
+        QVERIFY(a.handle() != c.handle() && c.handle() != m.handle());
+        QCOMPARE(core.subscriberCount("plant/state"), 3);
+
+        auto remote = [&](qint64 mid) {
+            MessageEnvelope env;
+            env.topic = "plant/state";
+            env.message_id = mid;
+            env.payload = QJsonObject{{"mid", mid}};
+            env.qos = "best_effort";
+            env.publisher_id = "plc-node";
+            core.onDatagram(Serializer::encodeEnvelope(env, "json"), QHostAddress::LocalHost, 40000);
+        };
+        remote(1);
+        QCOMPARE(archiver.size(), 1);
+        QCOMPARE(controller.size(), 1);
+        QCOMPARE(monitor.size(), 1);
+        QCOMPARE(archiver.first(), monitor.first());
+
+        QVERIFY(c.unsubscribe());
+        QVERIFY(!c.unsubscribe());
+        remote(2);
+        QCOMPARE(archiver.size(), 2);
+        QCOMPARE(controller.size(), 1);
+        QCOMPARE(monitor.size(), 2);
+
+        // A late subscriber catches up alone
+        QVector<QJsonObject> late;
+        core.makeSubscriber("plant/state", [&](const QJsonObject& o) { late << o; });
+        QCOMPARE(late.size(), 1);
+        QCOMPARE(late.first().value("message_id").toInt(), 2);   // the sample's own id and QoS
+        QCOMPARE(late.first().value("qos").toString(), QString("best_effort"));
+        QCOMPARE(archiver.size(), 2);
+        QCOMPARE(core.subscriberCount("plant/state"), 3);
+    }
+
+    void testWindowDedup() {
+        CaptureTransport transport;
+        DDSCore core("dedup-node", "1.0", &transport, nullptr);
+        int a = 0, b = 0;
+        core.makeSubscriber("dd/a", [&](const QJsonObject&) { ++a; });
+        core.makeSubscriber("dd/b", [&](const QJsonObject&) { ++b; });
+
+        auto rx = [&](const QString& topic, qint64 mid, quint64 seq) {
+            MessageEnvelope env;
+            env.topic = topic;
+            env.message_id = mid;
+            env.payload = QJsonObject{{"mid", mid}};
+            env.qos = "best_effort";
+            env.publisher_id = "w1";
+            env.seq = seq;
+            core.onDatagram(Serializer::encodeEnvelope(env, "json"), QHostAddress::LocalHost, 40000);
+        };
+        rx("dd/a", 1, 1);
+        rx("dd/a", 1, 1);                            // duplicate seq
+        rx("dd/b", 2, 1);                            // other stream of the same writer
+        rx("dd/a", 4, 3);
+        rx("dd/a", 3, 2);                            // late but not seen yet
+        rx("dd/a", 3, 2);
+        QCOMPARE(a, 3);
+        QCOMPARE(b, 1);
+
+        // Without seq: the writer's message ids
+        rx("dd/b", 10, 0);
+        rx("dd/b", 10, 0);
+        rx("dd/b", 11, 0);
+        QCOMPARE(b, 3);
+    }
+
+    void testUnwantedTopicsLeaveNoState() {
+        ConfigManager::ref().topics_list = QStringList{"conf/t"};
+        CaptureTransport transport;
+        DDSCore core("quiet-node", "1.0", &transport, nullptr);
+        QStringList wild;
+        core.makeSubscriber("zone/#", [&](const QJsonObject& o) { wild << o.value("topic").toString(); });
+
+        auto rx = [&](const QString& topic, qint64 mid) {
+            MessageEnvelope env;
+            env.topic = topic;
+            env.message_id = mid;
+            env.payload = QJsonObject{{"mid", mid}};
+            env.qos = "best_effort";
+            env.publisher_id = "chatty-node";
+            env.seq = quint64(mid);
+            core.onDatagram(Serializer::encodeEnvelope(env, "json"), QHostAddress::LocalHost, 40000);
+        };
+        rx("noise/unwanted-1", 1);
+        rx("noise/unwanted-2", 2);
+        QCOMPARE(TopicRegistry::instance().find("noise/unwanted-1"), TopicId(0)); // never interned
+        QCOMPARE(TopicRegistry::instance().find("noise/unwanted-2"), TopicId(0));
+
+        rx("zone/new", 3);                            // a wildcard subscription wants it
+        QCOMPARE(wild, QStringList{"zone/new"});
+
+        rx("conf/t", 4);                              // configured: kept for a late subscriber
+        int late = 0;
+        core.makeSubscriber("conf/t", [&](const QJsonObject& o) { late = o.value("mid").toInt(); });
+        QCOMPARE(late, 4);
+    }
+
+    void testIntraProcessDelivery() {
+        CaptureTransport transport;
+        DDSCore core("local-node", "1.0", &transport, nullptr);
+        QVector<QJsonObject> got;
+        core.makeSubscriber("local/t", [&](const QJsonObject& o) { got << o; });
+
+        const qint64 mid = core.publishInternal("local/t", QJsonObject{{"v", 7}}, "best_effort");
+        QCOMPARE(got.size(), 1);                     // synchronous, before any socket read
+        QCOMPARE(got.first().value("v").toInt(), 7);
+        QCOMPARE(got.first().value("message_id").toVariant().toLongLong(), mid);
+        QCOMPARE(transport.sent.size(), 1);          // still on the wire for remote peers
+
+        // Our own datagram echoed back is not delivered a second time
+        core.onDatagram(transport.sent.first().bytes, QHostAddress::LocalHost, 12345);
+        QCOMPARE(got.size(), 1);
+
+        ConfigManager::ref().transport.intra_process = false;
+        core.publishInternal("local/t", QJsonObject{{"v", 8}}, "best_effort");
+        QCOMPARE(got.size(), 1);
+    }
+
+    void testWildcardSubscriptions() {
+        CaptureTransport transport;
+        DDSCore core("wild-node", "1.0", &transport, nullptr);
+
+        core.publishInternal("wild/a/temp", QJsonObject{{"v", 0}}, "best_effort"); // known before the filter
+        QStringList all, temps;
+        Subscriber everything = core.makeSubscriber("wild/#", [&](const QJsonObject& o) { all << o.value("topic").toString(); });
+        core.makeSubscriber("wild/+/temp", [&](const QJsonObject& o) { temps << o.value("topic").toString(); });
+        QCOMPARE(all, QStringList{"wild/a/temp"});   // catch-up from the existing topic
+        QCOMPARE(core.subscriberCount("wild/a/temp"), 2);
+        QVERIFY(core.advertisedTopics().contains("wild/#"));
+
+        core.publishInternal("wild/b/temp", QJsonObject{{"v", 1}}, "best_effort"); // new topic
+        core.publishInternal("wild/b/hum", QJsonObject{{"v", 2}}, "best_effort");
+        QCOMPARE(all, (QStringList{"wild/a/temp", "wild/b/temp", "wild/b/hum"}));
+        QCOMPARE(temps, (QStringList{"wild/a/temp", "wild/b/temp"}));
+
+        QVERIFY(everything.unsubscribe());
+        core.publishInternal("wild/b/hum", QJsonObject{{"v", 3}}, "best_effort");
+        QCOMPARE(all.size(), 3);
+        QCOMPARE(core.subscriberCount("wild/b/hum"), 0);
+    }
+
+    void testContentFilteredSubscriptions() {
+        CaptureTransport transport;
+        DDSCore core("where-node", "1.0", &transport, nullptr);
+
+        QVector<int> hotValues, allValues;
+        core.makeSubscriber("where/t", "value > 30", [&](const QJsonObject& o) { hotValues << o.value("value").toInt(); });
+        QCOMPARE(core.advertisedContentFilters().value("where/t"), QStringList{"value > 30"});
+        Subscriber bad = core.makeSubscriber("where/t", "value >", [&](const QJsonObject&) { QFAIL("inert"); });
+        QCOMPARE(bad.handle(), quint64(0));
+
+        core.publishInternal("where/t", QJsonObject{{"value", 10}}, "best_effort");
+        core.publishInternal("where/t", QJsonObject{{"value", 40}}, "best_effort");
+        QCOMPARE(hotValues, QVector<int>{40});
+
+        Subscriber all = core.makeSubscriber("where/t", [&](const QJsonObject& o) { allValues << o.value("value").toInt(); });
+        QCOMPARE(allValues, QVector<int>{40});                  // catch-up with the last sample
+        QVERIFY(!core.advertisedContentFilters().contains("where/t"));
+        QVERIFY(all.unsubscribe());
+        QVERIFY(core.advertisedContentFilters().contains("where/t"));
+    }
+
+private:
+    std::optional<ConfigGuard> config; // each test starts from the same settings
+};
+
+QTEST_MAIN(TestDdsCoreDelivery)
+#include "test_dds_core_delivery.moc"
@@ -0,0 +1,224 @@
+#include <QTest>
+#include <optional>
+#include <QSignalSpy>
+#include <QDateTime>
+#include <QTemporaryDir>
+#include <QJsonArray>
+#include <QJsonObject>
+#include "ack_manager.h"
+#include "dds_core.h"
+#include "config_manager.h"
+#include "deadletter_writer.h"
+#include "tests/test_helpers/capture_transport.h"
+#include "tests/test_helpers/config_guard.h"
+
+// DDSCore's side of reliable delivery: stream acknowledgements and
+// dead-letter replay, with AckManager doing the tracking.
+class TestDdsCoreReliability : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init() { config.emplace(); }
+    void cleanup() { config.reset(); }
+
+    void testLateReaderAcksFirstSample() {
+        ConfigManager::ref().qos_cfg.reliable.ack_timeout_ms = 1000;
+        CaptureTransport writerNet, readerNet;
+        AckManager ack;
+        DDSCore writer("ack-writer", "1.0", &writerNet, &ack);
+        DDSCore reader("ack-reader", "1.0", &readerNet, nullptr);
+        int got = 0;
+        reader.makeSubscriber("late/t", [&](const QJsonObject&) { ++got; });
+
+        for (int i = 0; i < 70; ++i) writer.publishInternal("late/t", QJsonObject{{"v", i}}, "reliable"); // nobody listening
+        QJsonObject peer;
+        peer["node_id"] = "ack-reader";
+        peer["data_port"] = 46001;
+        peer["topics"] = QJsonArray{"late/t"};
+        writer.updatePeers("ack-reader", peer);
+        writer.publishInternal("late/t", QJsonObject{{"v", 70}}, "reliable");
+        QCOMPARE(writerNet.sent.size(), 2);            // the sample, then where the stream starts
+        QVERIFY(ack.hasPending());
+        auto start = Serializer::decodeEnvelopeView(writerNet.sent[1].bytes);
+        QVERIFY(start);
+        QCOMPARE(start->type, PacketType::Heartbeat);
+        QCOMPARE(start->first_seq, quint64(71));
+
+        // The heartbeat opens the reader's stream at seq 71, so its SACK covers it
+        for (const OutDatagram& d : std::as_const(writerNet.sent)) reader.onDatagram(d.bytes, QHostAddress::LocalHost, 12345);
+        QCOMPARE(got, 1);
+        QTRY_COMPARE(readerNet.sent.size(), 1);
+        writer.onDatagram(readerNet.sent.first().bytes, QHostAddress::LocalHost, 46001);
+        QVERIFY(!ack.hasPending());
+    }
+
+    void testLostFirstSampleIsRetransmitted() {
+        ConfigManager::ref().qos_cfg.reliable.ack_timeout_ms = 1000;
+        CaptureTransport writerNet, readerNet;
+        AckManager ack;
+        DDSCore writer("first-writer", "1.0", &writerNet, &ack);
+        DDSCore reader("first-reader", "1.0", &readerNet, nullptr);
+        QVector<int> got;
+        reader.makeSubscriber("first/t", [&](const QJsonObject& o) { got << o.value("v").toInt(); });
+        QJsonObject peer;
+        peer["node_id"] = "first-reader";
+        peer["data_port"] = 46004;
+        peer["topics"] = QJsonArray{"first/t"};
+        writer.updatePeers("first-reader", peer);
+
+        writer.publishInternal("first/t", QJsonObject{{"v", 1}}, "reliable");
+        writer.publishInternal("first/t", QJsonObject{{"v", 2}}, "reliable");
+        QCOMPARE(writerNet.sent.size(), 3);            // seq 1, the stream start, seq 2
+
+        // Seq 1 is lost. Seq 2 alone does not tell the reader where the stream
+        // starts, so it is delivered but not acknowledged.
+        reader.onDatagram(writerNet.sent[2].bytes, QHostAddress::LocalHost, 12345);
+        QCOMPARE(got, QVector<int>{2});
+        QTest::qWait(50);
+        QVERIFY(readerNet.sent.isEmpty());
+
+        // The stream starts at 1: the SACK reports seq 2 and leaves 1 missing
+        reader.onDatagram(writerNet.sent[1].bytes, QHostAddress::LocalHost, 12345);
+        QTRY_COMPARE(readerNet.sent.size(), 1);
+        auto sack = Serializer::decodeEnvelopeView(readerNet.sent.first().bytes);
+        QVERIFY(sack);
+        QCOMPARE(sack->cum_seq, quint64(0));
+        QCOMPARE(sack->sack_bits, quint32(0x2));      // bit i is seq cum + 1 + i
+        writer.onDatagram(readerNet.sent.first().bytes, QHostAddress::LocalHost, 46004);
+        QCOMPARE(ack.pendingCount(), 1);
+
+        // The retransmit brings seq 1, and the reader's next SACK retires it
+        writerNet.sent.clear();
+        readerNet.sent.clear();
+        ack.processTimeouts(QDateTime::currentMSecsSinceEpoch() + 5000);
+        QCOMPARE(writerNet.samples().size(), 1);
+        for (const OutDatagram& d : std::as_const(writerNet.sent)) reader.onDatagram(d.bytes, QHostAddress::LocalHost, 12345);
+        QCOMPARE(got, (QVector<int>{2, 1}));
+        QTRY_COMPARE(readerNet.sent.size(), 1);
+        sack = Serializer::decodeEnvelopeView(readerNet.sent.first().bytes);
+        QVERIFY(sack);
+        QCOMPARE(sack->cum_seq, quint64(2));
+        writer.onDatagram(readerNet.sent.first().bytes, QHostAddress::LocalHost, 46004);
+        QVERIFY(!ack.hasPending());
+    }
+
+    void testBestEffortStaysOutOfAckStream() {
+        ConfigManager::ref().qos_cfg.reliable.ack_timeout_ms = 1000;
+        CaptureTransport writerNet, readerNet;
+        AckManager ack;
+        DDSCore writer("mix-writer", "1.0", &writerNet, &ack);
+        DDSCore reader("mix-reader", "1.0", &readerNet, nullptr);
+        reader.makeSubscriber("mix/t", [](const QJsonObject&) {});
+        QJsonObject peer;
+        peer["node_id"] = "mix-reader";
+        peer["data_port"] = 46002;
+        peer["topics"] = QJsonArray{"mix/t"};
+        writer.updatePeers("mix-reader", peer);
+
+        writer.publishInternal("mix/t", QJsonObject{{"v", 1}}, "reliable");
+        writer.publishInternal("mix/t", QJsonObject{{"v", 2}}, "best_effort"); // lost on the way
+        writer.publishInternal("mix/t", QJsonObject{{"v", 3}}, "reliable");
+        QCOMPARE(writerNet.sent.size(), 4);            // [1] is the stream-start heartbeat
+        auto second = Serializer::decodeEnvelopeView(writerNet.sent[3].bytes);
+        QVERIFY(second);
+        QCOMPARE(second->seq, quint64(2));            // reliable numbering skips best-effort samples
+
+        reader.onDatagram(writerNet.sent[0].bytes, QHostAddress::LocalHost, 12345);
+        reader.onDatagram(writerNet.sent[1].bytes, QHostAddress::LocalHost, 12345);
+        reader.onDatagram(writerNet.sent[3].bytes, QHostAddress::LocalHost, 12345);
+        QTRY_COMPARE(readerNet.sent.size(), 1);
+        auto sack = Serializer::decodeEnvelopeView(readerNet.sent.first().bytes);
+        QVERIFY(sack);
+        QCOMPARE(sack->cum_seq, quint64(2));
+        QCOMPARE(sack->sack_bits, quint32(0));
+        writer.onDatagram(readerNet.sent.first().bytes, QHostAddress::LocalHost, 46002);
+        QVERIFY(!ack.hasPending());
+    }
+
+    void testPublisherRestartResetsStreams() {
+        CaptureTransport readerNet;
+        DDSCore reader("boot-reader", "1.0", &readerNet, nullptr);
+        int got = 0;
+        reader.makeSubscriber("boot/t", [&](const QJsonObject&) { ++got; });
+        QJsonObject peer;
+        peer["node_id"] = "boot-reader";
+        peer["data_port"] = 46003;
+        peer["topics"] = QJsonArray{"boot/t"};
+
+        auto run = [&](int samples) {
+            CaptureTransport writerNet;
+            AckManager ack;
+            DDSCore writer("boot-writer", "1.0", &writerNet, &ack);
+            writer.updatePeers("boot-reader", peer);
+            for (int i = 0; i < samples; ++i) writer.publishInternal("boot/t", QJsonObject{{"v", i}}, "reliable");
+            for (const OutDatagram& d : std::as_const(writerNet.sent)) reader.onDatagram(d.bytes, QHostAddress::LocalHost, 12345);
+            for (const OutDatagram& d : std::as_const(writerNet.sent)) reader.onDatagram(d.bytes, QHostAddress::LocalHost, 12345);
+        };
+        run(3);
+        QCOMPARE(got, 3);                             // the repeats were duplicates
+        run(2);                                       // same node id, numbering from 1 again
+        QCOMPARE(got, 5);
+    }
+
+    void testReplayWaitsForPeer() {
+        QTemporaryDir tempDir;
+        QVERIFY(tempDir.isValid());
+        const QString path = tempDir.filePath("replay.ndjson");
+        MessageEnvelope m;
+        m.topic = "replay/t";
+        m.message_id = 77;
+        m.payload = QJsonObject{{"v", 1}};
+        m.qos = "reliable";
+        m.publisher_id = "replay-node";
+        m.seq = 5;
+        {
+            DeadLetterWriter writer(path, true);
+            writer.append(DeadLetterRecord{1, 77, "late-peer", 3, "max_retries_exceeded", Serializer::encodeEnvelope(m, "json")});
+            writer.append(DeadLetterRecord{2, 78, "late-peer", 3, "max_retries_exceeded", QByteArray()}); // no sidecar bytes
+        }
+
+        CaptureTransport transport;
+        AckManager ack;
+        DDSCore core("replay-node", "1.0", &transport, &ack);
+        QSignalSpy drained(&core, &DDSCore::replayDrained);
+
+        QCOMPARE(core.replayDeadLetters(path, 100), 1);
+        QTest::qWait(250);                             // receiver unknown: nothing goes out
+        QVERIFY(transport.sent.isEmpty());
+        QCOMPARE(core.pendingReplays(), 1);
+
+        QJsonObject peer;
+        peer["node_id"] = "late-peer";
+        peer["data_port"] = 40077;
+        peer["topics"] = QJsonArray{"replay/t"};
+        core.updatePeers("late-peer", peer);
+        QTRY_COMPARE(drained.count(), 1);
+        QCOMPARE(transport.samplePorts(), QVector<quint16>{40077});
+        QCOMPARE(ack.pendingCount(), 1);
+        // Republished as a new sample, so the receiver does not take it for a duplicate
+        auto replayed = Serializer::decodeEnvelopeView(transport.sent.first().bytes);
+        QVERIFY(replayed);
+        QCOMPARE(replayed->seq, quint64(1));
+        QVERIFY(replayed->message_id != 77);
+        QVERIFY(replayed->incarnation != 0);
+        QCOMPARE(replayed->payload(), m.payload);
+        // Tracked by its new stream seq, so the receiver's SACK retires it
+        QCOMPARE(int(ack.ackRange("late-peer", TopicRegistry::instance().find("replay/t"), 1, 0).size()), 1);
+
+        // A second run only picks up letters added since the first one
+        QCOMPARE(core.replayDeadLetters(path, 100), 0);
+        {
+            DeadLetterWriter writer(path, true);
+            m.message_id = 79;
+            writer.append(DeadLetterRecord{3, 79, "late-peer", 3, "max_retries_exceeded", Serializer::encodeEnvelope(m, "json")});
+        }
+        QCOMPARE(core.replayDeadLetters(path, 100), 1);
+        QCOMPARE(core.replayDeadLetters(path, 100), 0);
+    }
+
+private:
+    std::optional<ConfigGuard> config; // each test starts from the same settings
+};
+
+QTEST_MAIN(TestDdsCoreReliability)
+#include "test_dds_core_reliability.moc"
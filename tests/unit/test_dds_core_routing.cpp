@@ -0,0 +1,224 @@
+#include <QTest>
+#include <optional>
+#include <QJsonArray>
+#include <QJsonObject>
+#include "ack_manager.h"
+#include "dds_core.h"
+#include "config_manager.h"
+#include "tests/test_helpers/capture_transport.h"
+#include "tests/test_helpers/config_guard.h"
+
+// Where DDSCore sends a publish: the routing index built from discovery,
+// per-format encoding, multicast, receiver topic ids, peer wildcard filters
+// and peer content filters.
+class TestDdsCoreRouting : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init() { config.emplace(); }
+    void cleanup() { config.reset(); }
+
+    void testReliableFanOutEncodesOncePerFormat() {
+        ConfigManager& cfg = ConfigManager::ref();
+        cfg.serialization.supported = {"json", "cbor"};
+        cfg.qos_cfg.reliable.ack_timeout_ms = 1000;
+
+        CaptureTransport transport;
+        AckManager ack;
+        DDSCore core("fanout-node", "1.0", &transport, &ack);
+
+        auto addPeer = [&](const QString& id, int port, const QStringList& formats) {
+            QJsonObject peer;
+            peer["node_id"] = id;
+            peer["data_port"] = port;
+            peer["topics"] = QJsonArray{"fan/out"};
+            peer["serialization"] = QJsonArray::fromStringList(formats);
+            core.updatePeers(id, peer);
+        };
+        addPeer("json-1", 40001, {"json"});
+        addPeer("json-2", 40002, {"json"});
+        addPeer("cbor-1", 40003, {"cbor"});
+
+        core.publishInternal("fan/out", QJsonObject{{"v", 1}}, "reliable");
+
+        const QVector<OutDatagram> samples = transport.samples();
+        QCOMPARE(samples.size(), 3);
+        QHash<quint16, QByteArray> byPort;
+        for (const OutDatagram& d : samples) byPort.insert(d.port, d.bytes);
+        QVERIFY(byPort.value(40001).isSharedWith(byPort.value(40002)));
+        QVERIFY(!byPort.value(40001).isSharedWith(byPort.value(40003)));
+        QCOMPARE(Serializer::detectFormat(byPort.value(40003)), WireFormat::Cbor);
+        QVERIFY(ack.hasPending());
+    }
+
+    void testReliableMulticastSendsOncePerFormat() {
+        auto& mc = ConfigManager::ref().transport.udp.multicast;
+        mc.enabled = true;
+        mc.group_base = QHostAddress("239.255.100.0");
+        ConfigManager::ref().qos_cfg.reliable.window_initial = 1;
+
+        const QHostAddress group = DDSCore::multicastGroupFor("mc/topic");
+        QVERIFY(group.isMulticast());
+        QCOMPARE(DDSCore::multicastGroupFor("mc/topic"), group);
+
+        CaptureTransport transport;
+        AckManager ack;
+        DDSCore core("mcast-node", "1.0", &transport, &ack);
+        Subscriber sub = core.makeSubscriber("mc/topic", [](const QJsonObject&) {});
+        QVERIFY(transport.joined.contains(group));
+
+        auto addPeer = [&](const QString& id, int port) {
+            QJsonObject peer;
+            peer["node_id"] = id;
+            peer["data_port"] = port;
+            peer["topics"] = QJsonArray{"mc/topic"};
+            peer["serialization"] = QJsonArray{"json"};
+            core.updatePeers(id, peer);
+        };
+        for (int i = 1; i <= 3; ++i) addPeer(QString("mc-%1").arg(i), 41000);
+        core.publishInternal("mc/topic", QJsonObject{{"v", 1}}, "reliable");
+        QCOMPARE(transport.samples().size(), 1);
+        QCOMPARE(transport.sent.first().to, group);
+        QCOMPARE(transport.sent.first().port, quint16(41000)); // the readers' port, not ours
+        QCOMPARE(transport.sent.size(), 4);                    // and each reader hears where the stream starts
+        QCOMPARE(ack.pendingCount(), 3);
+
+        // A reader on another data port gets its own group copy. The window
+        // (1 in flight) is full, but the group copy has gone out anyway, so
+        // nothing waits to be sent again by unicast.
+        addPeer("mc-4", 41004);
+        transport.sent.clear();
+        core.publishInternal("mc/topic", QJsonObject{{"v", 2}}, "reliable");
+        QCOMPARE(transport.samplePorts(), (QVector<quint16>{41000, 41004}));
+        QCOMPARE(ack.queuedCount(), 0);
+        QCOMPARE(ack.pendingCount(), 7);
+
+        // The last subscriber leaves the group
+        QVERIFY(transport.left.isEmpty());
+        QVERIFY(sub.unsubscribe());
+        QCOMPARE(transport.left, QVector<QHostAddress>{group});
+    }
+
+    void testRoutingIndexFollowsPeerUpdates() {
+        CaptureTransport transport;
+        AckManager ack;
+        DDSCore core("route-node", "1.0", &transport, &ack);
+
+        auto announce = [&](const QString& id, int port, const QJsonArray& topics) {
+            QJsonObject peer;
+            peer["node_id"] = id;
+            peer["data_port"] = port;
+            peer["topics"] = topics;
+            peer["transport_hint"] = "127.0.0.2";
+            core.updatePeers(id, peer);
+        };
+        announce("p1", 42001, {"route/a"});
+        announce("p2", 42002, {"route/b"});
+        announce("p2", 42002, {"route/b"});          // repeated announcement: no duplicate route
+
+        core.publishInternal("route/a", QJsonObject{{"v", 1}}, "reliable");
+        QCOMPARE(transport.samples().size(), 1);
+        QCOMPARE(transport.sent.first().to, QHostAddress("127.0.0.2"));
+        QCOMPARE(transport.sent.first().port, quint16(42001));
+
+        announce("p1", 42001, {"route/b"});          // p1 moved to route/b
+        transport.sent.clear();
+        core.publishInternal("route/a", QJsonObject{{"v", 2}}, "reliable");
+        QVERIFY(transport.sent.isEmpty());
+        core.publishInternal("route/b", QJsonObject{{"v", 3}}, "reliable");
+        QCOMPARE(transport.samples().size(), 2);
+
+        core.removePeer("p2");                        // expired
+        transport.sent.clear();
+        core.publishInternal("route/b", QJsonObject{{"v", 4}}, "reliable");
+        QCOMPARE(transport.samplePorts(), QVector<quint16>{42001});
+    }
+
+    void testBinaryUnicastUsesPeerTopicIds() {
+        CaptureTransport transport;
+        AckManager ack;
+        DDSCore core("ids-node", "1.0", &transport, &ack);
+
+        auto announce = [&](const QString& id, int port, const QJsonObject& ids) {
+            QJsonObject peer;
+            peer["node_id"] = id;
+            peer["data_port"] = port;
+            peer["topics"] = QJsonArray{"ids/t"};
+            peer["serialization"] = QJsonArray{"bin"};
+            if (!ids.isEmpty()) {
+                peer["topic_ids"] = ids;
+                peer["topic_epoch"] = 77;
+            }
+            core.updatePeers(id, peer);
+        };
+        announce("with-ids", 43001, QJsonObject{{"ids/t", 5}});
+        announce("names-only", 43002, QJsonObject());
+
+        core.publishInternal("ids/t", QJsonObject{{"v", 1}}, "reliable");
+        const QVector<OutDatagram> samples = transport.samples();
+        QCOMPARE(samples.size(), 2);
+        for (const OutDatagram& d : samples) {
+            QVERIFY(Serializer::isBinary(d.bytes));
+            const bool byId = quint8(d.bytes[4]) & BinaryWire::TopicById;
+            QCOMPARE(byId, d.port == 43001);
+            QCOMPARE(d.bytes.contains("ids/t"), !byId);
+        }
+    }
+
+    void testPeerWildcardFilters() {
+        CaptureTransport transport;
+        AckManager ack;
+        DDSCore core("wild-node", "1.0", &transport, &ack);
+        core.publishInternal("wild/a/temp", QJsonObject{{"v", 0}}, "best_effort"); // known before the peer
+
+        // A peer advertising a filter gets the topics it matches, known or not
+        QJsonObject peer;
+        peer["node_id"] = "monitor";
+        peer["data_port"] = 44001;
+        peer["topics"] = QJsonArray{"wild/#", "wild/a/temp"};
+        core.updatePeers("monitor", peer);
+        transport.sent.clear();
+        core.publishInternal("wild/a/temp", QJsonObject{{"v", 4}}, "reliable");  // named and matched: once
+        core.publishInternal("wild/c/new", QJsonObject{{"v", 5}}, "reliable");
+        core.publishInternal("other/t", QJsonObject{{"v", 6}}, "reliable");
+        QCOMPARE(transport.samplePorts(), (QVector<quint16>{44001, 44001}));
+
+        core.removePeer("monitor");
+        transport.sent.clear();
+        core.publishInternal("wild/c/new", QJsonObject{{"v", 7}}, "reliable");
+        QVERIFY(transport.sent.isEmpty());
+    }
+
+    void testPeerContentFiltersSendStubs() {
+        CaptureTransport transport;
+        AckManager ack;
+        DDSCore core("where-node", "1.0", &transport, &ack);
+
+        // A filtering peer gets a seq-only stub for samples it rejects
+        QJsonObject peer;
+        peer["node_id"] = "hot-only";
+        peer["data_port"] = 45001;
+        peer["topics"] = QJsonArray{"where/t"};
+        peer["serialization"] = QJsonArray{"bin"};
+        peer["content_filters"] = QJsonObject{{"where/t", QJsonArray{"value > 30"}}};
+        core.updatePeers("hot-only", peer);
+        core.publishInternal("where/t", QJsonObject{{"value", 12}}, "reliable");
+        core.publishInternal("where/t", QJsonObject{{"value", 42}}, "reliable");
+        const QVector<OutDatagram> samples = transport.samples();
+        QCOMPARE(samples.size(), 2);
+        auto stub = Serializer::decodeEnvelopeView(samples[0].bytes);
+        auto full = Serializer::decodeEnvelopeView(samples[1].bytes);
+        QVERIFY(stub && full);
+        QVERIFY(stub->filtered && !full->filtered);
+        QVERIFY(quint8(samples[0].bytes[4]) & BinaryWire::Filtered);
+        QCOMPARE(full->seq, stub->seq + 1);
+        QVERIFY(stub->payload().isEmpty());
+        QCOMPARE(full->payload().value("value").toInt(), 42);
+    }
+
+private:
+    std::optional<ConfigGuard> config; // each test starts from the same settings
+};
+
+QTEST_MAIN(TestDdsCoreRouting)
+#include "test_dds_core_routing.moc"
@@ -369,6 +369,113 @@ private slots:
 
         delete transport;
     }
+
+    // A burst queued on the socket is delivered in batches, intact and in order
+    void testBurstReceiveBatched() {
+        UdpTransport::Config rxCfg;
+        rxCfg.port = 38027;
+        rxCfg.rxBatch = 16;
+        UdpTransport rx(rxCfg);
+        UdpTransport tx(quint16(0));
+        QVector<QByteArray> received;
+        int largestBatch = 0;
+        connect(&rx, &ITransport::datagramsReceived, this, [&](const QVector<Datagram>& batch) {
+            largestBatch = qMax(largestBatch, int(batch.size()));
+            for (const Datagram& d : batch) received << d.bytes;
+        });
+
+        const int total = 100;
+        for (int i = 0; i < total; ++i) {
+            QVERIFY(tx.send(QByteArray::number(i), QHostAddress::LocalHost, rx.boundPort()));
+        }
+
+        QTRY_COMPARE_WITH_TIMEOUT(int(received.size()), total, 2000);
+        QVERIFY(largestBatch <= rxCfg.rxBatch + 1);
+        for (int i = 0; i < total; ++i) QCOMPARE(received.at(i), QByteArray::number(i));
+        // Each datagram owns a buffer of its own size, not a 64 KiB receive slot
+        for (const QByteArray& b : std::as_const(received)) QVERIFY(b.capacity() < 1024);
+    }
+
+    // With the receive thread on, batches cross the ring and arrive on this thread in order
+    void testThreadedReceive() {
+        UdpTransport::Config rxCfg;
+        rxCfg.port = 38029;
+        rxCfg.ioThread = true;
+        rxCfg.rxRing = 8;
+        UdpTransport rx(rxCfg);
+        UdpTransport tx(quint16(0));
+        QVector<QByteArray> received;
+        connect(&rx, &ITransport::datagramsReceived, this, [&](const QVector<Datagram>& batch) {
+            QCOMPARE(QThread::currentThread(), thread());
+            for (const Datagram& d : batch) received << d.bytes;
+        });
+
+        const int total = 200;
+        for (int i = 0; i < total; ++i) {
+            QVERIFY(tx.send(QByteArray::number(i), QHostAddress::LocalHost, rx.boundPort()));
+            if (i % 50 == 49) QTest::qWait(5); // let the ring drain between bursts
+        }
+
+        QTRY_COMPARE_WITH_TIMEOUT(int(received.size() + rx.rxRingDrops()), total, 2000);
+        for (int i = 1; i < received.size(); ++i) QVERIFY(received.at(i).toInt() > received.at(i - 1).toInt());
+        // Queued batches hold copies sized to each datagram, never the thread's receive slots
+        for (const QByteArray& b : std::as_const(received)) QVERIFY(b.capacity() < 1024);
+        rx.stop();
+    }
+
+    // Configured socket buffers are applied and the granted size is read back
+    void testSocketBuffersApplied() {
+        UdpTransport::Config c;
+        c.port = 0;
+        c.rcvbuf = 65536; // below the usual rmem_max, so the kernel grants it
+        c.sndbuf = 65536;
+        UdpTransport t(c);
+        QVERIFY(t.effectiveRcvbuf() >= c.rcvbuf);
+        QVERIFY(t.effectiveSndbuf() >= c.sndbuf);
+        QCOMPARE(t.kernelDrops(), quint64(0));
+    }
+
+    // Overflow of a small receive queue shows up in kernelDrops() without the receive thread
+    void testKernelDropsReported() {
+#ifndef Q_OS_LINUX
+        QSKIP("SO_RXQ_OVFL is Linux only");
+#endif
+        UdpTransport::Config c;
+        c.port = 0;
+        c.rcvbuf = 4096;
+        UdpTransport rx(c);
+        UdpTransport tx(quint16(0));
+        int received = 0;
+        connect(&rx, &ITransport::datagramsReceived, this, [&](const QVector<Datagram>& batch) { received += int(batch.size()); });
+
+        const QByteArray chunk(1000, 'x');
+        for (int i = 0; i < 200; ++i) tx.send(chunk, QHostAddress::LocalHost, rx.boundPort()); // nothing reads meanwhile
+        QTRY_COMPARE_WITH_TIMEOUT(quint64(received) + rx.kernelDrops(), quint64(200), 2000);
+        QVERIFY(rx.kernelDrops() > 0);
+    }
+
+    // A vectored send (with GSO coalescing of the equal-sized run) arrives intact and in order
+    void testBatchSend() {
+        UdpTransport rx(quint16(38028));
+        UdpTransport::Config txCfg;
+        txCfg.port = 0;
+        txCfg.gso = true;
+        UdpTransport tx(txCfg);
+        QVector<QByteArray> received;
+        connect(&rx, &ITransport::datagramsReceived, this, [&](const QVector<Datagram>& batch) {
+            for (const Datagram& d : batch) received << d.bytes;
+        });
+
+        QVector<OutDatagram> out;
+        for (int i = 0; i < 40; ++i) {
+            out.append(OutDatagram{QByteArray(64, char('a' + i % 26)), QHostAddress::LocalHost, rx.boundPort()});
+        }
+        out.append(OutDatagram{QByteArray("tail"), QHostAddress::LocalHost, rx.boundPort()});
+        QCOMPARE(tx.sendBatch(out), int(out.size()));
+
+        QTRY_COMPARE_WITH_TIMEOUT(int(received.size()), int(out.size()), 2000);
+        for (int i = 0; i < out.size(); ++i) QCOMPARE(received.at(i), out.at(i).bytes);
+    }
 };
 
 QTEST_MAIN(TestIntegrationScenarios)
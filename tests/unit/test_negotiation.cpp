@@ -35,6 +35,20 @@ private slots:
         QCOMPARE(result, "cbor");
     }
 
+    void testNegotiateFormatBinaryPreferred() {
+        QStringList ourPrefs = {"bin", "json", "cbor"};
+        QStringList peerPrefs = {"json", "cbor", "bin"};
+        QString result = Serializer::negotiateFormat(ourPrefs, peerPrefs);
+        QCOMPARE(result, "bin");
+    }
+
+    void testNegotiateFormatPeerWithoutBinary() {
+        QStringList ourPrefs = {"bin", "cbor", "json"};
+        QStringList peerPrefs = {"json", "cbor"};
+        QString result = Serializer::negotiateFormat(ourPrefs, peerPrefs);
+        QCOMPARE(result, "cbor");
+    }
+
     void testNegotiateFormatNoCommon() {
         QStringList ourPrefs = {"cbor"};
         QStringList peerPrefs = {"json"};
@@ -0,0 +1,48 @@
+#include <QTest>
+#include "seq_window.h"
+
+class TestSeqWindow : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testAcceptAndSlide() {
+        SeqWindow w;
+        QVERIFY(w.accept(1));
+        QVERIFY(w.accept(2));
+        QVERIFY(!w.accept(2));
+        QVERIFY(w.accept(5));
+        QCOMPARE(w.cumulative(), quint64(2));
+        QCOMPARE(w.sackBits(), quint32(0b100)); // 5 = cum + 1 + 2
+        QVERIFY(w.accept(3));
+        QVERIFY(w.accept(4));
+        QCOMPARE(w.cumulative(), quint64(5));
+        QCOMPARE(w.sackBits(), quint32(0));
+        QVERIFY(w.accept(200));                  // far ahead: slides, skipped seqs count as lost
+        QVERIFY(w.seen(100));
+        QVERIFY(!w.seen(199));
+        QVERIFY(!w.accept(150));                 // behind the window: duplicate
+        QVERIFY(w.accept(5000));
+        QVERIFY(!w.accept(1));                   // however far behind
+    }
+
+    void testGapsAndSkip() {
+        SeqWindow w;
+        QVERIFY(w.accept(1));
+        QVERIFY(w.accept(4));
+        QCOMPARE(w.highest(), quint64(4));
+        QCOMPARE(w.missingBits(), quint32(0b011));       // 2 and 3
+        QCOMPARE(w.missingBits(6), quint32(0b11011));    // a heartbeat announced up to 6
+        w.skipTo(3);                                     // publisher no longer holds 2
+        QCOMPARE(w.cumulative(), quint64(2));
+        QCOMPARE(w.missingBits(), quint32(0b1));
+        QVERIFY(w.accept(3));
+        QCOMPARE(w.cumulative(), quint64(4));
+        QCOMPARE(w.missingBits(), quint32(0));
+        w.skipTo(500);                                   // far ahead: window restarts at 500
+        QCOMPARE(w.cumulative(), quint64(499));
+        QVERIFY(w.accept(500));
+    }
+};
+
+QTEST_MAIN(TestSeqWindow)
+#include "test_seq_window.moc"
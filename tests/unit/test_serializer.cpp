@@ -324,6 +324,265 @@ private slots:
         QCOMPARE(decodedSer[1].toString(), "json");
     }
 
+    // Binary envelope tests
+    void testRoundTripDataBinary() {
+        QJsonObject payload{{"temp", 25.5}, {"unit", "C"}, {"active", true}};
+        MessageEnvelope msg{"sensor/temp", 456, payload, 1234567890, "reliable", "node-test"};
+
+        QByteArray encoded = Serializer::encodeDataBinary(msg);
+        QVERIFY(Serializer::isBinary(encoded));
+        PacketType pt;
+        auto decoded = Serializer::decode(encoded, &pt);
+
+        QVERIFY(decoded.has_value());
+        QCOMPARE(pt, PacketType::Data);
+        QCOMPARE(decoded->value("topic").toString(), "sensor/temp");
+        QCOMPARE(decoded->value("message_id").toVariant().toLongLong(), 456LL);
+        QCOMPARE(decoded->value("timestamp").toVariant().toLongLong(), 1234567890LL);
+        QCOMPARE(decoded->value("publisher_id").toString(), "node-test");
+        QCOMPARE(decoded->value("qos").toString(), "reliable");
+
+        QJsonObject decodedPayload = decoded->value("payload").toObject();
+        QCOMPARE(decodedPayload.value("temp").toDouble(), 25.5);
+        QCOMPARE(decodedPayload.value("unit").toString(), "C");
+        QCOMPARE(decodedPayload.value("active").toBool(), true);
+    }
+
+    void testRoundTripAckBinary() {
+        QByteArray encoded = Serializer::encodeAck(789, "node-rx", "ACK", 1234567890, "bin");
+        PacketType pt;
+        auto decoded = Serializer::decode(encoded, &pt);
+
+        QVERIFY(decoded.has_value());
+        QCOMPARE(pt, PacketType::Ack);
+        QCOMPARE(decoded->value("message_id").toVariant().toLongLong(), 789LL);
+        QCOMPARE(decoded->value("receiver_node_id").toString(), "node-rx");
+        QCOMPARE(decoded->value("status").toString(), "ACK");
+    }
+
+    void testEnvelopeBinarySmallerThanText() {
+        MessageEnvelope msg{"sensor/temp", 1, QJsonObject{{"v", 1}}, 1234567890, "best_effort", "node-1"};
+        const QByteArray bin = Serializer::encodeEnvelope(msg, "bin");
+        QVERIFY(bin.size() < Serializer::encodeEnvelope(msg, "cbor").size());
+        QVERIFY(bin.size() < Serializer::encodeEnvelope(msg, "json").size());
+
+        auto decoded = Serializer::decodeEnvelope(bin, "bin");
+        QVERIFY(decoded.has_value());
+        QCOMPARE(decoded->qos, QString("best_effort"));
+        QCOMPARE(decoded->payload.value("v").toInt(), 1);
+    }
+
+    void testEnvelopeTopicById() {
+        TopicRegistry& registry = TopicRegistry::instance();
+        const TopicId id = registry.intern("sensor/temperature/room-42");
+        MessageEnvelope msg{"sensor/temperature/room-42", 9, QJsonObject{{"v", 1}}, 1234567890, "reliable", "node-1"};
+        msg.seq = 3;
+        msg.incarnation = 77;                    // sits between the seq and the topic
+        const QByteArray byName = Serializer::encodeDataBinary(msg);
+        msg.topic_ref = id;
+        msg.topic_epoch = registry.epoch();
+        const QByteArray byId = Serializer::encodeDataBinary(msg);
+        QVERIFY(byId.size() < byName.size());
+
+        auto v = Serializer::decodeEnvelopeView(byId);
+        QVERIFY(v.has_value());
+        QCOMPARE(v->topic, QString("sensor/temperature/room-42"));
+        QCOMPARE(v->topic_id, id);
+        QCOMPARE(v->seq, quint64(3));
+        QCOMPARE(v->payload().value("v").toInt(), 1);
+
+        // Ids from a previous run of the receiver are not trusted
+        msg.topic_epoch = registry.epoch() == 1 ? 2 : registry.epoch() - 1;
+        QVERIFY(!Serializer::decodeEnvelopeView(Serializer::encodeDataBinary(msg)).has_value());
+
+        // Dead letters are rewritten with the name and read back anywhere
+        const QByteArray named = Serializer::withTopicName(Serializer::encodeDataBinary(msg), msg.topic);
+        QCOMPARE(named, byName);
+        QCOMPARE(Serializer::withTopicName(byName, msg.topic), byName);
+    }
+
+    void testDiscoveryTopicIds() {
+        DiscoveryPacket pkt;
+        pkt.node_id = "node-ids";
+        pkt.topics = QStringList{"a/b", "c/d"};
+        pkt.topic_ids = QHash<QString, quint32>{{"a/b", 1}, {"c/d", 7}};
+        pkt.topic_epoch = 4242;
+        const auto back = Serializer::from_json(Serializer::to_json(pkt));
+        QVERIFY(back.has_value());
+        QCOMPARE(back->topic_ids, pkt.topic_ids);
+        QCOMPARE(back->topic_epoch, quint32(4242));
+
+        // CBOR discovery carries everything the JSON form does
+        pkt.protocol_version = "1.0";
+        pkt.timestamp = 1234567890;
+        pkt.data_port = 38020;
+        pkt.qos_modes = QStringList{"reliable", "reliable_nack"};
+        pkt.content_filters = QHash<QString, QStringList>{{"a/b", {"value > 30"}}};
+        const auto cbor = Serializer::decodeDiscovery(Serializer::encodeDiscovery(pkt, "cbor"), "cbor");
+        QVERIFY(cbor.has_value());
+        QCOMPARE(Serializer::detectFormat(Serializer::encodeDiscovery(pkt, "cbor")), WireFormat::Cbor);
+        QCOMPARE(cbor->node_id, pkt.node_id);
+        QCOMPARE(cbor->data_port, quint16(38020));
+        QCOMPARE(cbor->topic_ids, pkt.topic_ids);
+        QCOMPARE(cbor->topic_epoch, quint32(4242));
+        QCOMPARE(cbor->qos_modes, pkt.qos_modes);
+        QCOMPARE(cbor->content_filters, pkt.content_filters);
+
+        DiscoveryPacket plain;
+        plain.node_id = "node-plain";
+        QVERIFY(!Serializer::to_json(plain).contains("topic_ids"));
+    }
+
+    void testFilteredStubAndContentFilters() {
+        MessageEnvelope stub{"sensor/temp", 12, QJsonObject(), 1234567890, "reliable", "node-1"};
+        stub.seq = 8;
+        stub.filtered = true;
+        for (const QString& fmt : {QString("json"), QString("cbor"), QString("bin")}) {
+            auto v = Serializer::decodeEnvelopeView(Serializer::encodeEnvelope(stub, fmt));
+            QVERIFY2(v.has_value(), qPrintable(fmt));
+            QVERIFY2(v->filtered, qPrintable(fmt));
+            QCOMPARE(v->seq, quint64(8));
+        }
+        stub.filtered = false;
+        QVERIFY(!Serializer::decodeEnvelopeView(Serializer::encodeEnvelope(stub, "bin"))->filtered);
+
+        DiscoveryPacket pkt;
+        pkt.node_id = "node-where";
+        pkt.topics = QStringList{"sensor/temp"};
+        pkt.content_filters = QHash<QString, QStringList>{{"sensor/temp", {"value > 30", "unit = 'F'"}}};
+        const auto back = Serializer::from_json(Serializer::to_json(pkt));
+        QVERIFY(back.has_value());
+        QCOMPARE(back->content_filters, pkt.content_filters);
+    }
+
+    void testMalformedBinaryTruncated() {
+        MessageEnvelope msg{"sensor/temp", 456, QJsonObject{{"temp", 25}}, 1234567890, "reliable", "node-1"};
+        QByteArray encoded = Serializer::encodeDataBinary(msg);
+        encoded.chop(3);
+        PacketType pt;
+        auto result = Serializer::decode(encoded, &pt);
+        QVERIFY(!result.has_value());
+        QCOMPARE(pt, PacketType::Unknown);
+    }
+
+    // Envelope view tests
+    void testEnvelopeViewAllFormats() {
+        QJsonObject payload{{"temp", 25.5}, {"unit", "C"}};
+        MessageEnvelope msg{"sensor/temp", 456, payload, 1234567890, "reliable", "node-test"};
+
+        for (const QString& fmt : {QString("json"), QString("cbor"), QString("bin")}) {
+            auto view = Serializer::decodeEnvelopeView(Serializer::encodeEnvelope(msg, fmt));
+            QVERIFY2(view.has_value(), qPrintable(fmt));
+            QCOMPARE(view->type, PacketType::Data);
+            QCOMPARE(view->topic, QString("sensor/temp"));
+            QCOMPARE(view->message_id, 456LL);
+            QCOMPARE(view->timestamp, 1234567890LL);
+            QCOMPARE(view->publisher_id, QString("node-test"));
+            QCOMPARE(view->qos, QString("reliable"));
+            QCOMPARE(view->payload(), payload);
+        }
+    }
+
+    void testEnvelopeViewLazyPayload() {
+        MessageEnvelope msg{"sensor/temp", 7, QJsonObject{{"v", 1}}, 0, "best_effort", "node-1"};
+        const QByteArray packet = Serializer::encodeDataCBOR(msg);
+        auto view = Serializer::decodeEnvelopeView(packet);
+        QVERIFY(view.has_value());
+        // Header decode leaves the payload encoded inside the datagram
+        QVERIFY(view->payload_offset > 0);
+        QVERIFY(view->payload_offset + view->payload_size <= packet.size());
+        QVERIFY(view->json_payload.isEmpty());
+        QCOMPARE(view->payload().value("v").toInt(), 1);
+    }
+
+    void testEnvelopeViewAck() {
+        for (const QString& fmt : {QString("json"), QString("cbor"), QString("bin")}) {
+            auto view = Serializer::decodeEnvelopeView(Serializer::encodeAck(789, "node-rx", "ACK", 1, fmt));
+            QVERIFY2(view.has_value(), qPrintable(fmt));
+            QCOMPARE(view->type, PacketType::Ack);
+            QCOMPARE(view->message_id, 789LL);
+            QCOMPARE(view->receiver_id, QString("node-rx"));
+        }
+    }
+
+    void testEnvelopeSeqAndSack() {
+        MessageEnvelope msg{"sensor/temp", 9, QJsonObject{{"v", 1}}, 5, "reliable", "node-1", 42};
+        msg.incarnation = 0xBEEF;
+        SackPacket sack;
+        sack.topic = "sensor/temp";
+        sack.publisher_id = "node-1";
+        sack.receiver_id = "node-rx";
+        sack.cum_seq = 40;
+        sack.sack_bits = 0x80000005u;
+        sack.timestamp = 7;
+        for (const QString& fmt : {QString("json"), QString("cbor"), QString("bin")}) {
+            auto data = Serializer::decodeEnvelopeView(Serializer::encodeEnvelope(msg, fmt));
+            QVERIFY2(data.has_value(), qPrintable(fmt));
+            QCOMPARE(data->seq, quint64(42));
+            QCOMPARE(Serializer::decodeEnvelope(Serializer::encodeEnvelope(msg, fmt), fmt)->seq, quint64(42));
+            QCOMPARE(data->incarnation, quint32(0xBEEF));
+            QCOMPARE(Serializer::decodeEnvelope(Serializer::encodeEnvelope(msg, fmt), fmt)->incarnation, quint32(0xBEEF));
+
+            auto view = Serializer::decodeEnvelopeView(Serializer::encodeSack(sack, fmt));
+            QVERIFY2(view.has_value(), qPrintable(fmt));
+            QCOMPARE(view->type, PacketType::Sack);
+            QCOMPARE(view->topic, sack.topic);
+            QCOMPARE(view->publisher_id, sack.publisher_id);
+            QCOMPARE(view->receiver_id, sack.receiver_id);
+            QCOMPARE(view->cum_seq, sack.cum_seq);
+            QCOMPARE(view->sack_bits, sack.sack_bits);
+        }
+        SackPacket hb = sack;
+        hb.receiver_id.clear();
+        hb.first_seq = 3;
+        hb.sack_bits = 0;
+        for (const QString& fmt : {QString("json"), QString("cbor"), QString("bin")}) {
+            auto nack = Serializer::decodeEnvelopeView(Serializer::encodeNack(sack, fmt));
+            QVERIFY2(nack.has_value(), qPrintable(fmt));
+            QCOMPARE(nack->type, PacketType::Nack);
+            QCOMPARE(nack->cum_seq, sack.cum_seq);
+            QCOMPARE(nack->sack_bits, sack.sack_bits);
+
+            auto beat = Serializer::decodeEnvelopeView(Serializer::encodeHeartbeat(hb, fmt));
+            QVERIFY2(beat.has_value(), qPrintable(fmt));
+            QCOMPARE(beat->type, PacketType::Heartbeat);
+            QCOMPARE(beat->topic, hb.topic);
+            QCOMPARE(beat->publisher_id, hb.publisher_id);
+            QCOMPARE(beat->first_seq, quint64(3));
+            QCOMPARE(beat->cum_seq, quint64(40));
+            QVERIFY(beat->qos.isEmpty());
+            QCOMPARE(beat->incarnation, quint32(0));
+
+            // ACK-mode start: the reader and the publisher's incarnation travel along
+            SackPacket start = hb;
+            start.receiver_id = "r1";
+            start.qos = "reliable";
+            start.incarnation = 77;
+            auto opened = Serializer::decodeEnvelopeView(Serializer::encodeHeartbeat(start, fmt));
+            QVERIFY2(opened.has_value(), qPrintable(fmt));
+            QCOMPARE(opened->qos, QString("reliable"));
+            QCOMPARE(opened->incarnation, quint32(77));
+            QCOMPARE(opened->receiver_id, QString("r1"));
+            QCOMPARE(opened->first_seq, quint64(3));
+        }
+        msg.qos = "reliable_nack";
+        QCOMPARE(Serializer::decodeEnvelopeView(Serializer::encodeEnvelope(msg, "bin"))->qos, QString("reliable_nack"));
+        // No seq: nothing extra on the wire
+        msg.seq = 0;
+        msg.incarnation = 0;
+        QVERIFY(!Serializer::encodeEnvelope(msg, "json").contains("seq"));
+        QVERIFY(!Serializer::encodeEnvelope(msg, "json").contains("incarnation"));
+        QCOMPARE(Serializer::decodeEnvelopeView(Serializer::encodeEnvelope(msg, "bin"))->seq, quint64(0));
+    }
+
+    void testEnvelopeViewMissingField() {
+        QCborMap map;
+        map[QCborValue("type")] = QCborValue("data");
+        map[QCborValue("topic")] = QCborValue("sensor/temp");
+        map[QCborValue("message_id")] = QCborValue(1);
+        QVERIFY(!Serializer::decodeEnvelopeView(map.toCborValue().toCbor()).has_value());
+    }
+
     // Malformed frame tests
     void testMalformedCBORMap() {
         // Create invalid CBOR (not a map)
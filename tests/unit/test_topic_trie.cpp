@@ -0,0 +1,50 @@
+#include <QTest>
+#include <QString>
+#include <QVector>
+#include <algorithm>
+#include "topic_trie.h"
+
+class TestTopicTrie : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testMatchesAndValidity() {
+        QVERIFY(TopicTrie<int>::matches("wild/#", "wild"));
+        QVERIFY(TopicTrie<int>::matches("wild/+/temp", "wild/a/temp"));
+        QVERIFY(!TopicTrie<int>::matches("wild/+", "wild/a/temp"));
+        QVERIFY(TopicTrie<int>::matches("wild/a", "wild/a"));
+        QVERIFY(!TopicTrie<int>::isValidFilter("wild/#/x"));
+        QVERIFY(!TopicTrie<int>::isValidFilter("wild/a+"));
+        QVERIFY(!TopicTrie<int>::isValidFilter(""));
+        QVERIFY(TopicTrie<int>::isPattern("wild/+/temp"));
+        QVERIFY(!TopicTrie<int>::isPattern("wild/a/temp"));
+    }
+
+    void testInsertMatchRemove() {
+        TopicTrie<int> trie;
+        QVERIFY(trie.isEmpty());
+        trie.insert("wild/#", 1);
+        trie.insert("wild/+/temp", 2);
+        trie.insert("wild/a/temp", 3);
+        trie.insert("other/+", 4);
+
+        QVector<int> m = trie.match("wild/a/temp");
+        std::sort(m.begin(), m.end());
+        QCOMPARE(m, (QVector<int>{1, 2, 3}));
+        QCOMPARE(trie.match("wild"), QVector<int>{1});
+        QVERIFY(trie.match("other/a/b").isEmpty());
+
+        QVERIFY(trie.remove("wild/+/temp", 2));
+        QVERIFY(!trie.remove("wild/+/temp", 2));
+        QVERIFY(!trie.remove("never/+", 2));
+        m = trie.match("wild/b/temp");
+        QCOMPARE(m, QVector<int>{1});
+        QVERIFY(trie.remove("wild/#", 1));
+        QVERIFY(trie.remove("wild/a/temp", 3));
+        QVERIFY(trie.remove("other/+", 4));
+        QVERIFY(trie.isEmpty());
+    }
+};
+
+QTEST_MAIN(TestTopicTrie)
+#include "test_topic_trie.moc"
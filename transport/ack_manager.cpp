@@ -1,86 +1,347 @@
 #include "ack_manager.h"
 #include "config_manager.h"
+#include "serializer.h"
 #include <QDateTime>
+#include <QDebug>
 #include <QtGlobal>
-#include <QFile>
-#include <QDir>
-#include <QFileInfo>
+#include <QStringList>
 
 static inline qint64 nowMs() { return QDateTime::currentMSecsSinceEpoch(); }
 
 AckManager::AckManager(QObject* parent): QObject(parent) {
+    wheel.resize(kWheelSlots);
+    wheel_cursor = nowMs() / kSlotMs - 1;
     connect(&timer, &QTimer::timeout, this, &AckManager::onTick);
     timer.start(30);
 }
 
-QString AckManager::makeKey(qint64 msg_id, const QString& receiverId) {
-    return QString::number(msg_id) + ":" + receiverId;
+int AckManager::internReceiver(const QString& receiverId) {
+    auto it = receiver_ids.constFind(receiverId);
+    if (it != receiver_ids.constEnd()) {
+        if (windows[*it].released) { // back before its slot was reclaimed
+            windows[*it].released = false;
+            releasing.removeOne(*it);
+        }
+        return *it;
+    }
+    quint16 idx;
+    if (!free_slots.isEmpty()) {
+        idx = free_slots.takeLast();
+    } else if (windows.size() < kMaxReceivers) {
+        idx = quint16(windows.size());
+        rtt.append(RttEstimate());
+        windows.append(SendWindow());
+    } else {
+        qCritical() << "[ACK] receiver table full (" << kMaxReceivers << "); not tracking messages to" << receiverId;
+        return -1;
+    }
+    receiver_ids.insert(receiverId, idx);
+    rtt[idx] = RttEstimate{receiverId};
+    windows[idx] = SendWindow();
+    windows[idx].cwnd = qMax(1, ConfigManager::ref().qos_cfg.reliable.window_initial);
+    return idx;
+}
+
+void AckManager::releaseReceiver(const QString& receiverId) {
+    auto it = receiver_ids.constFind(receiverId);
+    if (it == receiver_ids.constEnd() || windows[*it].released) return;
+    windows[*it].released = true;
+    releasing.append(*it);
+    reclaim();
+}
+
+// Frees the slots of released receivers that have nothing in flight or queued
+void AckManager::reclaim() {
+    for (int i = 0; i < releasing.size();) {
+        const quint16 rx = releasing[i];
+        const SendWindow& w = windows[rx];
+        if (w.in_flight > 0 || !w.queued.isEmpty()) { ++i; continue; }
+        receiver_ids.remove(rtt[rx].receiver_id);
+        rtt[rx] = RttEstimate();
+        windows[rx] = SendWindow();
+        free_slots.append(rx);
+        releasing.removeAt(i);
+    }
 }
 
 void AckManager::track(const Pending& p) {
-    pending.insert(makeKey(p.msg_id, p.receiver_id), p);
+    const int slot = internReceiver(p.receiver_id);
+    if (slot < 0) {
+        giveUp(p, nowMs(), QStringLiteral("receiver_table_full"));
+        return;
+    }
+    const quint16 rx = quint16(slot);
+    const quint64 key = makeKey(rx, p.msg_id);
+    if (!pending.contains(key)) ++windows[rx].in_flight;
+    Pending& stored = pending.insert(key, p);
+    if (stored.sent_ms == 0) stored.sent_ms = nowMs();
+    const auto& rel = ConfigManager::ref().qos_cfg.reliable;
+    if (rel.adaptive_rto && rtt[rx].samples > 0) {
+        stored.base_timeout_ms = rtt[rx].rto_ms;
+        stored.deadline_ms = stored.sent_ms + stored.base_timeout_ms;
+    }
+    schedule(key, stored.deadline_ms);
+    if (stored.seq) {
+        const quint64 sk = streamKey(rx, stored.topic_id);
+        QMap<quint64, qint64>* stream = streams.find(sk);
+        if (!stream) stream = &streams.insert(sk, {});
+        stream->insert(stored.seq, stored.msg_id);
+    }
+}
+
+bool AckManager::submit(const Pending& p) {
+    const int rx = internReceiver(p.receiver_id);
+    if (rx < 0) {
+        giveUp(p, nowMs(), QStringLiteral("receiver_table_full"));
+        return false;
+    }
+    SendWindow& w = windows[rx];
+    if (w.queued.isEmpty() && w.in_flight < int(w.cwnd)) {
+        track(p);
+        return true;
+    }
+    const int maxQueue = ConfigManager::ref().qos_cfg.reliable.max_queue;
+    if (w.queued.size() >= maxQueue) {
+        if (w.queued.isEmpty()) { // queueing disabled
+            giveUp(p, nowMs(), QStringLiteral("send_queue_full"));
+            return false;
+        }
+        // Oldest first: it is the most stale sample for this peer
+        const Pending dropped = w.queued.dequeue();
+        --queued_total;
+        giveUp(dropped, nowMs(), QStringLiteral("send_queue_full"));
+    }
+    const bool first = w.queued.isEmpty();
+    w.queued.enqueue(p);
+    ++queued_total;
+    if (first) emit backpressure(p.receiver_id, true); // last: slots may publish again
+    return false;
+}
+
+int AckManager::queuedFor(const QString& receiverId) const {
+    auto it = receiver_ids.constFind(receiverId);
+    return it == receiver_ids.constEnd() ? 0 : int(windows[*it].queued.size());
+}
+
+int AckManager::windowFor(const QString& receiverId) const {
+    auto it = receiver_ids.constFind(receiverId);
+    if (it == receiver_ids.constEnd()) return qMax(1, ConfigManager::ref().qos_cfg.reliable.window_initial);
+    return int(windows[*it].cwnd);
+}
+
+void AckManager::grow(quint16 receiverIdx) {
+    SendWindow& w = windows[receiverIdx];
+    const double cap = qMax(1, ConfigManager::ref().qos_cfg.reliable.max_in_flight);
+    w.cwnd = qMin(cap, w.cwnd + 1.0 / w.cwnd);
+}
+
+void AckManager::shrink(quint16 receiverIdx, qint64 now) {
+    SendWindow& w = windows[receiverIdx];
+    // One loss episode usually times out a whole window; cut once per RTO
+    const qint64 rto = rtt[receiverIdx].samples > 0 ? rtt[receiverIdx].rto_ms
+                                                    : ConfigManager::ref().qos_cfg.reliable.ack_timeout_ms;
+    if (now - w.last_cut_ms < rto) return;
+    w.cwnd = qMax(1.0, w.cwnd / 2);
+    w.last_cut_ms = now;
+}
+
+// Moves queued messages into flight wherever the window has room
+void AckManager::release() {
+    if (queued_total == 0) return;
+    const qint64 now = nowMs();
+    QVector<Pending> ready;
+    QStringList drained;
+    for (int rx = 0; rx < windows.size(); ++rx) {
+        SendWindow& w = windows[rx];
+        if (w.queued.isEmpty()) continue;
+        while (!w.queued.isEmpty() && w.in_flight < int(w.cwnd)) {
+            Pending p = w.queued.dequeue();
+            --queued_total;
+            p.sent_ms = 0;
+            p.deadline_ms = now + p.base_timeout_ms;
+            track(p);
+            ready.append(p);
+        }
+        if (w.queued.isEmpty()) drained << rtt[rx].receiver_id;
+    }
+    if (!ready.isEmpty()) emit dispatch(ready);
+    for (const QString& rx : drained) emit backpressure(rx, false);
+}
+
+// Drops a pending record that was acknowledged; `p` must not alias the map slot
+void AckManager::retire(quint64 key, const Pending& p, bool sample) {
+    const quint16 rx = quint16(key >> 48);
+    // Karn: an ACK for a retransmitted message is ambiguous, so it is not a sample
+    if (sample && p.attempt == 0) sampleRtt(rx, nowMs() - p.sent_ms);
+    if (p.seq) {
+        const quint64 sk = streamKey(rx, p.topic_id);
+        if (auto* stream = streams.find(sk); stream && stream->remove(p.seq) && stream->isEmpty()) streams.erase(sk);
+    }
+    if (pending.erase(key)) --windows[rx].in_flight;
 }
 
 void AckManager::ackReceived(qint64 msg_id, const QString& receiverId) {
-    pending.remove(makeKey(msg_id, receiverId));
+    auto it = receiver_ids.constFind(receiverId);
+    if (it != receiver_ids.constEnd()) {
+        const quint64 key = makeKey(*it, msg_id);
+        if (const Pending* p = pending.find(key)) {
+            retire(key, Pending(*p), true);
+            grow(*it);
+        }
+    }
     ack_count++;
+    release();
+    reclaim();
+}
+
+QVector<qint64> AckManager::ackRange(const QString& receiverId, TopicId topic, quint64 cumSeq, quint32 sackBits) {
+    auto rxIt = receiver_ids.constFind(receiverId);
+    if (rxIt == receiver_ids.constEnd() || !topic) return {};
+    const quint16 rx = *rxIt;
+    QMap<quint64, qint64>* stream = streams.find(streamKey(rx, topic));
+    if (!stream || stream->isEmpty()) return {};
+
+    QVector<qint64> acked;
+    for (auto it = stream->begin(); it != stream->end() && it.key() <= cumSeq; ++it) acked << it.value();
+    for (int i = 0; i < 32; ++i) {
+        if (!((sackBits >> i) & 1u)) continue;
+        auto it = stream->constFind(cumSeq + 1 + quint64(i));
+        if (it != stream->constEnd()) acked << it.value();
+    }
+    // Only the newest retired message feeds the RTT estimate; the older ones also
+    // carry the receiver's ACK delay.
+    for (int i = 0; i < acked.size(); ++i) {
+        const quint64 key = makeKey(rx, acked[i]);
+        if (const Pending* p = pending.find(key)) {
+            retire(key, Pending(*p), i == acked.size() - 1);
+            grow(rx);
+        }
+    }
+    ack_count += int(acked.size());
+    release();
+    reclaim();
+    return acked;
+}
+
+quint64 AckManager::oldestSeq(const QString& receiverId, TopicId topic) const {
+    auto rxIt = receiver_ids.constFind(receiverId);
+    if (rxIt == receiver_ids.constEnd()) return 0;
+    quint64 oldest = 0;
+    const QMap<quint64, qint64>* stream = streams.find(streamKey(*rxIt, topic));
+    if (stream && !stream->isEmpty()) oldest = stream->firstKey();
+    for (const Pending& p : windows[*rxIt].queued) {
+        if (p.seq && p.topic_id == topic && (!oldest || p.seq < oldest)) oldest = p.seq;
+    }
+    return oldest;
+}
+
+void AckManager::sampleRtt(quint16 receiverIdx, qint64 rtt_ms) {
+    RttEstimate& e = rtt[receiverIdx];
+    const double r = double(qMax<qint64>(0, rtt_ms));
+    if (e.samples == 0) {
+        e.srtt_ms = r;
+        e.rttvar_ms = r / 2;
+    } else {
+        e.rttvar_ms = 0.75 * e.rttvar_ms + 0.25 * qAbs(e.srtt_ms - r);
+        e.srtt_ms = 0.875 * e.srtt_ms + 0.125 * r;
+    }
+    ++e.samples;
+    const auto& rel = ConfigManager::ref().qos_cfg.reliable;
+    // The variance term is floored at the wheel granularity, as RFC 6298 does with G
+    const qint64 rto = qint64(e.srtt_ms + qMax(double(kSlotMs), 4 * e.rttvar_ms));
+    e.rto_ms = qBound<qint64>(rel.min_rto_ms, rto, rel.max_rto_ms);
+}
+
+QVector<RttEstimate> AckManager::rttEstimates() const {
+    QVector<RttEstimate> out;
+    for (const RttEstimate& e : rtt) if (e.samples > 0) out.append(e);
+    return out;
+}
+
+std::optional<RttEstimate> AckManager::rttFor(const QString& receiverId) const {
+    auto it = receiver_ids.constFind(receiverId);
+    if (it == receiver_ids.constEnd() || rtt[*it].samples == 0) return std::nullopt;
+    return rtt[*it];
+}
+
+void AckManager::schedule(quint64 key, qint64 deadline_ms) {
+    qint64 slot = deadline_ms / kSlotMs;
+    if (slot <= wheel_cursor) slot = wheel_cursor + 1; // already overdue: next tick
+    wheel[int(slot % kWheelSlots)].append(WheelEntry{key, deadline_ms});
 }
 
 void AckManager::onTick() {
-    const qint64 now = nowMs();
-    QList<QString> toRemove;
-    QList<QString> toUpdate;
-    QHash<QString, Pending> updates;
-
-    for (auto it = pending.begin(); it != pending.end(); ++it) {
-        auto p = it.value();
-        if (now >= p.deadline_ms) {
-            if (p.retries_left > 0) {
-                p.attempt += 1;
-                p.retries_left -= 1;
-                qint64 next = p.base_timeout_ms;
-                if (p.exponential_backoff) next = p.base_timeout_ms * (1LL << qMin(p.attempt, 10));
-                p.deadline_ms = now + next;
-                emit resend(p);
-                // Collect updates instead of modifying during iteration
-                toUpdate << it.key();
-                updates[it.key()] = p;
-            } else {
-                toRemove << it.key();
-                // Bounded dead-letter buffer (ring, size 128)
-                if (dead_letters.size() >= 128) {
-                    dead_letters.pop_front();
-                }
-                dead_letters.push_back(DeadLetter{p.msg_id, p.receiver_id, p.packet, now});
-                emit failed(p.msg_id, p.receiver_id);
-                emit deadLetter(p.msg_id, p.receiver_id, p.attempt, "max_retries_exceeded");
-                appendDeadLetter(p.msg_id, p.receiver_id, p.attempt, "max_retries_exceeded");
-            }
+    processTimeouts(nowMs());
+}
+
+void AckManager::processTimeouts(qint64 now) {
+    const qint64 target = now / kSlotMs;
+    if (target <= wheel_cursor) return;
+    qint64 from = wheel_cursor + 1;
+    if (target - from >= kWheelSlots) from = target - kWheelSlots + 1; // every slot once
+    QVector<Pending> due;
+
+    for (qint64 s = from; s <= target; ++s) {
+        wheel_cursor = s;
+        QVector<WheelEntry> bucket;
+        bucket.swap(wheel[int(s % kWheelSlots)]); // retries may land back in this slot
+        QVector<WheelEntry> later;
+        for (const WheelEntry& e : bucket) {
+            Pending* p = pending.find(e.key);
+            if (!p || p->deadline_ms != e.deadline_ms) continue; // acked or rescheduled
+            if (e.deadline_ms > now) { later.append(e); continue; } // a later rotation
+            expire(e.key, *p, now, due);
         }
+        if (!later.isEmpty()) wheel[int(s % kWheelSlots)].append(later);
     }
+    wheel_cursor = target;
+
+    if (!due.isEmpty()) emit resendBatch(due);
+    release(); // give-ups free window slots
+    reclaim();
+}
 
-    // Apply updates after iteration is complete
-    for (const auto& key : toUpdate) {
-        pending[key] = updates[key];
+void AckManager::expire(quint64 key, Pending& p, qint64 now, QVector<Pending>& due) {
+    if (p.retries_left > 0) {
+        p.attempt += 1;
+        p.retries_left -= 1;
+        qint64 next = p.base_timeout_ms;
+        if (p.exponential_backoff) next = p.base_timeout_ms * (1LL << qMin(p.attempt, 10));
+        p.deadline_ms = now + next;
+        schedule(key, p.deadline_ms);
+        due << p;
+        shrink(quint16(key >> 48), now);
+        emit resend(due.last()); // a copy: receivers may ACK and drop the record
+        return;
     }
+    const Pending gone = std::move(p);
+    retire(key, gone, false);
+    giveUp(gone, now, QStringLiteral("max_retries_exceeded"));
+}
 
-    for (const auto& k : toRemove) pending.remove(k);
+void AckManager::giveUp(Pending gone, qint64 now, const QString& reason) {
+    // The receiver's topic ids die with its process; a dead letter must outlive that
+    gone.packet = Serializer::withTopicName(gone.packet, gone.topic);
+    // Bounded dead-letter buffer (ring, size 128)
+    if (dead_letters.size() >= 128) {
+        dead_letters.pop_front();
+    }
+    dead_letters.push_back(DeadLetter{gone.msg_id, gone.receiver_id, gone.packet, now});
+    emit failed(gone.msg_id, gone.receiver_id);
+    emit deadLetter(gone.msg_id, gone.receiver_id, gone.attempt, reason);
+    appendDeadLetter(gone, reason, now);
 }
 
-void AckManager::appendDeadLetter(qint64 id, const QString& rx, int attempts, const QString& reason) {
-    QString path = ConfigManager::ref().logging.deadletter_file;
-    if (path.isEmpty()) path = QStringLiteral("logs/dds_deadletter.ndjson");
-    QDir().mkpath(QFileInfo(path).absolutePath());
-    QFile f(path);
-    if (f.open(QIODevice::Append|QIODevice::Text)) {
-        const auto line = QString(R"({"ts":%1,"message_id":%2,"receiver":"%3","attempts":%4,"reason":"%5"})")
-                          .arg(QDateTime::currentMSecsSinceEpoch())
-                          .arg(id)
-                          .arg(rx)
-                          .arg(attempts)
-                          .arg(reason);
-        f.write(line.toUtf8());
-        f.write("\n");
-        f.close();
+void AckManager::appendDeadLetter(const Pending& p, const QString& reason, qint64 now) {
+    if (!dl_writer) {
+        const auto& log = ConfigManager::ref().logging;
+        QString path = log.deadletter_file;
+        if (path.isEmpty()) path = QStringLiteral("logs/dds_deadletter.ndjson");
+        dl_writer = std::make_unique<DeadLetterWriter>(path, log.deadletter_packets);
     }
+    dl_writer->append(DeadLetterRecord{now, p.msg_id, p.receiver_id, p.attempt, reason, p.packet});
+}
+
+void AckManager::flushDeadLetters() {
+    if (dl_writer) dl_writer->flush();
 }
@@ -0,0 +1,165 @@
+#include "deadletter_writer.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QDebug>
+
+DeadLetterWriter::DeadLetterWriter(const QString& path, bool withPackets)
+    : path_(path), withPackets_(withPackets) {
+    thread_ = QThread::create([this] { run(); });
+    thread_->setObjectName(QStringLiteral("deadletter"));
+    thread_->start(QThread::LowPriority);
+}
+
+DeadLetterWriter::~DeadLetterWriter() {
+    {
+        QMutexLocker lock(&mutex_);
+        stopping_ = true;
+        wake_.wakeOne();
+    }
+    thread_->wait();
+    delete thread_;
+}
+
+QString DeadLetterWriter::sidecarPathFor(const QString& path) {
+    const QFileInfo fi(path);
+    return fi.path() + QLatin1Char('/') + fi.completeBaseName() + QStringLiteral(".bin");
+}
+
+QString DeadLetterWriter::replayCursorPathFor(const QString& path) {
+    return path + QStringLiteral(".replayed");
+}
+
+qint64 DeadLetterWriter::replayCursor(const QString& path) {
+    QFile f(replayCursorPathFor(path));
+    if (!f.open(QIODevice::ReadOnly)) return 0;
+    bool ok = false;
+    const qint64 offset = f.readAll().trimmed().toLongLong(&ok);
+    // A log that shrank was rotated or truncated; start over on the new one
+    if (!ok || offset < 0 || offset > QFileInfo(path).size()) return 0;
+    return offset;
+}
+
+bool DeadLetterWriter::setReplayCursor(const QString& path, qint64 offset) {
+    QFile f(replayCursorPathFor(path));
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "[DEADLETTER] cannot write" << f.fileName() << ":" << f.errorString();
+        return false;
+    }
+    return f.write(QByteArray::number(offset) + '\n') > 0;
+}
+
+QVector<DeadLetterRecord> DeadLetterWriter::readAll(const QString& path, qint64 from, qint64* end) {
+    QVector<DeadLetterRecord> out;
+    if (end) *end = from;
+    QFile log(path);
+    if (!log.open(QIODevice::ReadOnly)) {
+        qWarning() << "[DEADLETTER] cannot read" << path << ":" << log.errorString();
+        return out;
+    }
+    if (from > 0 && !log.seek(from)) return out;
+    QFile sidecar(sidecarPathFor(path));
+    const QByteArray packets = sidecar.open(QIODevice::ReadOnly) ? sidecar.readAll() : QByteArray();
+    int skipped = 0;
+    qint64 done = log.pos();
+    while (!log.atEnd()) {
+        const QByteArray raw = log.readLine();
+        if (!raw.endsWith('\n')) break;       // still being written; left for the next read
+        done = log.pos();
+        const QByteArray line = raw.trimmed();
+        if (line.isEmpty()) continue;
+        const QJsonObject o = QJsonDocument::fromJson(line).object();
+        if (!o.contains(QStringLiteral("message_id"))) { ++skipped; continue; }
+        DeadLetterRecord r;
+        r.ts_ms = o.value(QStringLiteral("ts")).toVariant().toLongLong();
+        r.msg_id = o.value(QStringLiteral("message_id")).toVariant().toLongLong();
+        r.receiver_id = o.value(QStringLiteral("receiver")).toString();
+        r.attempts = o.value(QStringLiteral("attempts")).toInt();
+        r.reason = o.value(QStringLiteral("reason")).toString();
+        const qint64 offset = o.value(QStringLiteral("packet_offset")).toVariant().toLongLong();
+        const int size = o.value(QStringLiteral("packet_size")).toInt();
+        if (size > 0 && offset >= 0 && offset + size <= packets.size()) r.packet = packets.mid(int(offset), size);
+        out.append(r);
+    }
+    if (end) *end = done;
+    if (skipped) qWarning() << "[DEADLETTER] skipped" << skipped << "malformed lines in" << path;
+    return out;
+}
+
+void DeadLetterWriter::append(DeadLetterRecord r) {
+    QMutexLocker lock(&mutex_);
+    queue_.append(std::move(r));
+    ++appended_;
+    wake_.wakeOne();
+}
+
+void DeadLetterWriter::flush() {
+    QMutexLocker lock(&mutex_);
+    const quint64 target = appended_;
+    while (written_ < target) done_.wait(&mutex_);
+}
+
+quint64 DeadLetterWriter::written() const {
+    QMutexLocker lock(&mutex_);
+    return written_;
+}
+
+void DeadLetterWriter::run() {
+    QDir().mkpath(QFileInfo(path_).absolutePath());
+    QFile log(path_);
+    if (!log.open(QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "[DEADLETTER] cannot open" << path_ << ":" << log.errorString();
+    }
+    QFile sidecar(sidecarPathFor(path_));
+    if (withPackets_ && !sidecar.open(QIODevice::Append)) {
+        qWarning() << "[DEADLETTER] cannot open" << sidecar.fileName() << ":" << sidecar.errorString();
+    }
+
+    QVector<DeadLetterRecord> batch;
+    for (;;) {
+        {
+            QMutexLocker lock(&mutex_);
+            while (queue_.isEmpty() && !stopping_) wake_.wait(&mutex_);
+            if (queue_.isEmpty()) break; // stopping, nothing left
+            batch.swap(queue_);
+        }
+
+        QByteArray lines;
+        QByteArray packets;
+        qint64 offset = sidecar.isOpen() ? sidecar.size() : 0;
+        for (const DeadLetterRecord& r : std::as_const(batch)) {
+            QJsonObject o{
+                {"ts", r.ts_ms},
+                {"message_id", r.msg_id},
+                {"receiver", r.receiver_id},
+                {"attempts", r.attempts},
+                {"reason", r.reason}
+            };
+            if (sidecar.isOpen() && !r.packet.isEmpty()) {
+                o["packet_offset"] = offset;
+                o["packet_size"] = int(r.packet.size());
+                packets.append(r.packet);
+                offset += r.packet.size();
+            }
+            lines.append(QJsonDocument(o).toJson(QJsonDocument::Compact));
+            lines.append('\n');
+        }
+        // Sidecar first: a line never points at bytes that are not on disk yet
+        if (!packets.isEmpty()) {
+            sidecar.write(packets);
+            sidecar.flush();
+        }
+        if (log.isOpen()) {
+            log.write(lines);
+            log.flush();
+        }
+
+        QMutexLocker lock(&mutex_);
+        written_ += quint64(batch.size());
+        batch.clear();
+        done_.wakeAll();
+    }
+}
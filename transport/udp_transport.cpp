@@ -1,7 +1,52 @@
 #include "udp_transport.h"
 #include <QDebug>
+#include <QSocketNotifier>
+#include <vector>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <cerrno>
+#include <poll.h>
+#endif
 
-UdpTransport::UdpTransport(quint16 bindPort, QObject* parent): ITransport(parent) {
+UdpTransport::UdpTransport(quint16 bindPort, QObject* parent)
+    : UdpTransport(Config{bindPort}, parent) {}
+
+UdpTransport::UdpTransport(const Config& cfg, QObject* parent): ITransport(parent), cfg_(cfg) {
+    cfg_.rxBatch = qMax(1, cfg_.rxBatch);
+    cfg_.maxDatagramSize = qMax(512, cfg_.maxDatagramSize);
+    bindSocket(cfg_.port);
+    applyBufferSizes();
+    batch_.reserve(cfg_.rxBatch);
+#ifdef Q_OS_LINUX
+    if (cfg_.ioThread && sock.state() == QAbstractSocket::BoundState) {
+        // readyRead stays unconnected: QUdpSocket only peeks at the descriptor and
+        // every datagram is read by the receive thread.
+        ring_.reset(new SpscRing<QVector<Datagram>>(cfg_.rxRing));
+        rxStop_.store(false);
+        const int fd = int(sock.socketDescriptor());
+        rxThread_ = QThread::create([this, fd] { rxLoop(fd); });
+        rxThread_->setObjectName(QStringLiteral("udp-rx"));
+        rxThread_->start(QThread::TimeCriticalPriority);
+        qInfo() << "[UDP][RX][THREAD] started ring=" << ring_->capacity() << " batch=" << cfg_.rxBatch;
+        return;
+    }
+    if (sock.state() == QAbstractSocket::BoundState) {
+        // Our own notifier rather than readyRead: QUdpSocket would have to read
+        // the first datagram itself, and readDatagram drops its SO_RXQ_OVFL cmsg
+        rxNotifier_ = new QSocketNotifier(sock.socketDescriptor(), QSocketNotifier::Read, this);
+        connect(rxNotifier_, &QSocketNotifier::activated, this, &UdpTransport::onReadyRead);
+        return;
+    }
+#else
+    if (cfg_.ioThread) qWarning() << "[UDP][RX][THREAD] receive thread needs Linux; using the event loop";
+#endif
+    connect(&sock, &QUdpSocket::readyRead, this, &UdpTransport::onReadyRead);
+}
+
+void UdpTransport::bindSocket(quint16 bindPort) {
     if (!sock.bind(QHostAddress::AnyIPv4, bindPort, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
         qWarning() << "[UDP][BIND][FAIL] port=" << bindPort << " reason=" << sock.errorString();
         // Try ephemeral port
@@ -14,7 +59,6 @@ UdpTransport::UdpTransport(quint16 bindPort, QObject* parent): ITransport(parent
     } else {
         qInfo() << "[UDP][BIND][OK] port=" << bindPort;
     }
-    connect(&sock, &QUdpSocket::readyRead, this, &UdpTransport::onReadyRead);
 }
 
 bool UdpTransport::send(const QByteArray& datagram, const QHostAddress& to, quint16 port) {
@@ -22,14 +66,329 @@ bool UdpTransport::send(const QByteArray& datagram, const QHostAddress& to, quin
 }
 
 void UdpTransport::onReadyRead() {
-    while (sock.hasPendingDatagrams()) {
-        QByteArray d; d.resize(int(sock.pendingDatagramSize()));
-        QHostAddress from; quint16 p = 0;
-        sock.readDatagram(d.data(), d.size(), &from, &p);
-        emit datagramReceived(d, from, p);
+    // Every datagram goes through drainBatch, the first one included
+    int got = cfg_.rxBatch;
+    while (got == cfg_.rxBatch && sock.state() == QAbstractSocket::BoundState) {
+        got = drainBatch(int(sock.socketDescriptor()), batch_);
+        if (!batch_.isEmpty()) emit datagramsReceived(batch_);
+        batch_.clear(); // capacity is kept for the next read
+    }
+}
+
+#ifdef Q_OS_LINUX
+struct UdpTransport::MmsgScratch {
+    std::vector<mmsghdr> msgs;
+    std::vector<iovec> iov;
+    std::vector<sockaddr_storage> addrs;
+    std::vector<char> control; // one SO_RXQ_OVFL cmsg slot per message
+};
+
+static constexpr size_t kOvflCmsgSpace = CMSG_SPACE(sizeof(quint32));
+
+int UdpTransport::drainBatch(int fd, QVector<Datagram>& out) {
+    const int n = cfg_.rxBatch;
+    if (!rx_) {
+        rx_.reset(new MmsgScratch);
+        rx_->msgs.resize(n);
+        rx_->iov.resize(n);
+        rx_->addrs.resize(n);
+        rx_->control.resize(size_t(n) * kOvflCmsgSpace);
+        rxSlots_.resize(n);
+        for (QByteArray& slot : rxSlots_) slot = QByteArray(cfg_.maxDatagramSize, Qt::Uninitialized);
+    }
+    auto& msgs = rx_->msgs;
+    auto& iov = rx_->iov;
+    auto& addrs = rx_->addrs;
+    for (int i = 0; i < n; ++i) {
+        QByteArray& slot = rxSlots_[i];
+        iov[i] = { slot.data(), size_t(slot.size()) };
+        msgs[i] = {};
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        msgs[i].msg_hdr.msg_control = rx_->control.data() + size_t(i) * kOvflCmsgSpace;
+        msgs[i].msg_hdr.msg_controllen = kOvflCmsgSpace;
+    }
+    const int got = ::recvmmsg(fd, msgs.data(), unsigned(n), MSG_DONTWAIT, nullptr);
+    if (got <= 0) return 0; // EAGAIN: queue is empty
+    // The kernel's drop count is cumulative; the last message carries the newest value
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msgs[got - 1].msg_hdr); cm; cm = CMSG_NXTHDR(&msgs[got - 1].msg_hdr, cm)) {
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) {
+            quint32 dropped = 0;
+            memcpy(&dropped, CMSG_DATA(cm), sizeof(dropped));
+            kernelDrops_.store(dropped, std::memory_order_relaxed);
+        }
+    }
+    for (int i = 0; i < got; ++i) {
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            qWarning() << "[UDP][RX][TRUNC] datagram larger than" << cfg_.maxDatagramSize << "bytes dropped";
+            continue;
+        }
+        // Copied out at its real length: sharing the slot would pin a
+        // maxDatagramSize allocation for as long as any consumer keeps the bytes
+        Datagram d;
+        d.bytes = QByteArray(rxSlots_[i].constData(), int(msgs[i].msg_len));
+        d.from = QHostAddress(reinterpret_cast<const sockaddr*>(&addrs[i]));
+        if (addrs[i].ss_family == AF_INET) {
+            d.port = ntohs(reinterpret_cast<const sockaddr_in*>(&addrs[i])->sin_port);
+        }
+        out.append(std::move(d));
     }
+    return got;
+}
+#else
+struct UdpTransport::MmsgScratch {};
+
+int UdpTransport::drainBatch(int fd, QVector<Datagram>& out) {
+    Q_UNUSED(fd);
+    int got = 0;
+    while (got < cfg_.rxBatch && sock.hasPendingDatagrams()) {
+        Datagram d;
+        d.bytes.resize(int(sock.pendingDatagramSize()));
+        sock.readDatagram(d.bytes.data(), d.bytes.size(), &d.from, &d.port);
+        out.append(std::move(d));
+        ++got;
+    }
+    return got;
+}
+#endif
+
+#ifdef Q_OS_LINUX
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+int UdpTransport::sendBatch(const QVector<OutDatagram>& batch) {
+    const int n = int(batch.size());
+    if (n <= 1) return ITransport::sendBatch(batch);
+
+    // One mmsghdr per destination run; with GSO a run of equal-sized datagrams
+    // (the last may be shorter) to the same peer becomes one UDP_SEGMENT send.
+    constexpr int kMaxSegments = 64;
+    constexpr int kMaxGsoBytes = 65000;
+    constexpr int kMaxGsoSegment = 1400; // segments must fit the path MTU or the kernel refuses them
+    constexpr size_t kCmsgSpace = CMSG_SPACE(sizeof(quint16));
+    std::vector<mmsghdr> msgs;
+    std::vector<iovec> iov(n);
+    std::vector<sockaddr_in> addrs;
+    std::vector<char> control;
+    std::vector<int> runStart, runLen;
+    msgs.reserve(n); addrs.reserve(n); runStart.reserve(n); runLen.reserve(n);
+    control.resize(size_t(n) * kCmsgSpace);
+    int sent = 0;
+
+    for (int i = 0; i < n;) {
+        const OutDatagram& d = batch[i];
+        if (d.to.protocol() != QAbstractSocket::IPv4Protocol) {
+            sent += send(d.bytes, d.to, d.port) ? 1 : 0;
+            ++i;
+            continue;
+        }
+        int j = i + 1;
+        if (cfg_.gso && d.bytes.size() <= kMaxGsoSegment) {
+            const int seg = int(d.bytes.size());
+            int total = seg;
+            while (j < n && j - i < kMaxSegments
+                   && batch[j].to == d.to && batch[j].port == d.port
+                   && batch[j].bytes.size() <= seg && total + batch[j].bytes.size() <= kMaxGsoBytes) {
+                total += int(batch[j].bytes.size());
+                if (batch[j++].bytes.size() < seg) break; // a short segment must be last
+            }
+        }
+        for (int k = i; k < j; ++k) {
+            iov[k] = { const_cast<char*>(batch[k].bytes.constData()), size_t(batch[k].bytes.size()) };
+        }
+        sockaddr_in sa{};
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(d.port);
+        sa.sin_addr.s_addr = htonl(d.to.toIPv4Address());
+        addrs.push_back(sa);
+        mmsghdr m{};
+        m.msg_hdr.msg_name = &addrs.back();
+        m.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        m.msg_hdr.msg_iov = &iov[i];
+        m.msg_hdr.msg_iovlen = size_t(j - i);
+        if (j - i > 1) {
+            char* buf = control.data() + msgs.size() * kCmsgSpace;
+            m.msg_hdr.msg_control = buf;
+            m.msg_hdr.msg_controllen = kCmsgSpace;
+            cmsghdr* cm = CMSG_FIRSTHDR(&m.msg_hdr);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(quint16));
+            const quint16 segSize = quint16(d.bytes.size());
+            memcpy(CMSG_DATA(cm), &segSize, sizeof(segSize));
+        }
+        msgs.push_back(m);
+        runStart.push_back(i);
+        runLen.push_back(j - i);
+        i = j;
+    }
+
+    const int fd = int(sock.socketDescriptor());
+    int done = 0;
+    const int total = int(msgs.size());
+    while (done < total) {
+        const int r = ::sendmmsg(fd, msgs.data() + done, unsigned(total - done), 0);
+        if (r <= 0) {
+            if (errno == EIO && cfg_.gso) {
+                qWarning() << "[UDP][TX][GSO] UDP_SEGMENT rejected by the kernel; disabling GSO";
+                cfg_.gso = false;
+            }
+            break;
+        }
+        for (int k = done; k < done + r; ++k) sent += runLen[size_t(k)];
+        done += r;
+    }
+    // Whatever sendmmsg did not take goes out one datagram at a time
+    for (int k = done; k < total; ++k) {
+        for (int x = runStart[size_t(k)]; x < runStart[size_t(k)] + runLen[size_t(k)]; ++x) {
+            sent += send(batch[x].bytes, batch[x].to, batch[x].port) ? 1 : 0;
+        }
+    }
+    return sent;
+}
+#else
+int UdpTransport::sendBatch(const QVector<OutDatagram>& batch) {
+    return ITransport::sendBatch(batch);
+}
+#endif
+
+#ifdef Q_OS_LINUX
+void UdpTransport::rxLoop(int fd) {
+    pollfd pfd{fd, POLLIN, 0};
+    while (!rxStop_.load(std::memory_order_relaxed)) {
+        const int r = ::poll(&pfd, 1, 100); // bounded wait so stop() is noticed
+        if (r <= 0) continue;
+        if (pfd.revents & (POLLERR | POLLNVAL)) break;
+        for (;;) {
+            QVector<Datagram> batch;
+            batch.reserve(cfg_.rxBatch);
+            const int got = drainBatch(fd, batch);
+            if (got == 0) break;
+            const int n = int(batch.size());
+            if (n == 0) continue; // only truncated datagrams in this round
+            if (!ring_->tryPush(std::move(batch))) {
+                // Core is behind; count the loss instead of blocking the socket
+                rxDrops_.fetch_add(quint64(n), std::memory_order_relaxed);
+                continue;
+            }
+            // Only the push that finds no wakeup outstanding posts one
+            if (!wakeQueued_.exchange(true)) {
+                QMetaObject::invokeMethod(this, &UdpTransport::drainRing, Qt::QueuedConnection);
+            }
+            if (got < cfg_.rxBatch) break;
+        }
+    }
+}
+#endif
+
+void UdpTransport::drainRing() {
+    if (!ring_) return;
+    wakeQueued_.store(false);
+    QVector<Datagram> batch;
+    while (ring_->tryPop(batch)) {
+        emit datagramsReceived(batch);
+    }
+}
+
+void UdpTransport::stopRxThread() {
+    if (!rxThread_) return;
+    rxStop_.store(true);
+    rxThread_->wait();
+    delete rxThread_;
+    rxThread_ = nullptr;
+    const quint64 drops = rxDrops_.load();
+    if (drops) qWarning() << "[UDP][RX][THREAD] stopped; datagrams dropped on full ring:" << drops;
+}
+
+#ifdef Q_OS_LINUX
+// Sets `opt`, retrying with the privileged *FORCE variant when the kernel caps
+// the request at rmem_max/wmem_max. Returns the usable size (Linux reports double).
+static int applyBuffer(int fd, int opt, int forceOpt, int requested) {
+    int got = 0;
+    socklen_t len = sizeof(got);
+    if (requested > 0) {
+        ::setsockopt(fd, SOL_SOCKET, opt, &requested, sizeof(requested));
+        ::getsockopt(fd, SOL_SOCKET, opt, &got, &len);
+        if (got / 2 < requested) {
+            ::setsockopt(fd, SOL_SOCKET, forceOpt, &requested, sizeof(requested)); // needs CAP_NET_ADMIN
+        }
+    }
+    len = sizeof(got);
+    ::getsockopt(fd, SOL_SOCKET, opt, &got, &len);
+    return got / 2;
+}
+#endif
+
+void UdpTransport::applyBufferSizes() {
+    if (sock.state() != QAbstractSocket::BoundState) return;
+#ifdef Q_OS_LINUX
+    const int fd = int(sock.socketDescriptor());
+    effRcvbuf_ = applyBuffer(fd, SO_RCVBUF, SO_RCVBUFFORCE, cfg_.rcvbuf);
+    effSndbuf_ = applyBuffer(fd, SO_SNDBUF, SO_SNDBUFFORCE, cfg_.sndbuf);
+    const int on = 1;
+    if (::setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) != 0) {
+        qWarning() << "[UDP][BUF] SO_RXQ_OVFL unavailable; kernel drop counter disabled";
+    }
+#else
+    if (cfg_.rcvbuf > 0) sock.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, cfg_.rcvbuf);
+    if (cfg_.sndbuf > 0) sock.setSocketOption(QAbstractSocket::SendBufferSizeSocketOption, cfg_.sndbuf);
+    effRcvbuf_ = sock.socketOption(QAbstractSocket::ReceiveBufferSizeSocketOption).toInt();
+    effSndbuf_ = sock.socketOption(QAbstractSocket::SendBufferSizeSocketOption).toInt();
+#endif
+    if (cfg_.rcvbuf > 0 && effRcvbuf_ < cfg_.rcvbuf) {
+        qWarning() << "[UDP][BUF] rcvbuf clamped: requested=" << cfg_.rcvbuf << " effective=" << effRcvbuf_ << " (raise net.core.rmem_max)";
+    }
+    if (cfg_.sndbuf > 0 && effSndbuf_ < cfg_.sndbuf) {
+        qWarning() << "[UDP][BUF] sndbuf clamped: requested=" << cfg_.sndbuf << " effective=" << effSndbuf_ << " (raise net.core.wmem_max)";
+    }
+    qInfo() << "[UDP][BUF] rcvbuf=" << effRcvbuf_ << " sndbuf=" << effSndbuf_;
+}
+
+UdpTransport::~UdpTransport() {
+    stopRxThread();
+    delete rxNotifier_; // before the socket closes its descriptor
+}
+
+bool UdpTransport::joinGroup(const QHostAddress& group) {
+    int& refs = groupRefs[group.toIPv4Address()];
+    if (refs > 0) { ++refs; return true; }
+    if (!sock.joinMulticastGroup(group)) {
+        qWarning() << "[UDP][MCAST][JOIN][FAIL] group=" << group.toString() << " reason=" << sock.errorString();
+        groupRefs.remove(group.toIPv4Address());
+        return false;
+    }
+    refs = 1;
+    qInfo() << "[UDP][MCAST][JOIN] group=" << group.toString() << " port=" << sock.localPort();
+    return true;
+}
+
+void UdpTransport::leaveGroup(const QHostAddress& group) {
+    auto it = groupRefs.find(group.toIPv4Address());
+    if (it == groupRefs.end()) return;
+    if (--it.value() > 0) return;
+    groupRefs.erase(it);
+    sock.leaveMulticastGroup(group);
+}
+
+void UdpTransport::setMulticastOptions(int ttl, bool loopback) {
+    sock.setSocketOption(QAbstractSocket::MulticastTtlOption, ttl);
+    sock.setSocketOption(QAbstractSocket::MulticastLoopbackOption, loopback ? 1 : 0);
 }
 
 quint16 UdpTransport::boundPort() const { return sock.localPort(); }
 
-void UdpTransport::stop() { sock.close(); }
+void UdpTransport::stop() {
+    stopRxThread();
+    if (rxNotifier_) {
+        rxNotifier_->setEnabled(false); // stop() may run from a receive callback
+        rxNotifier_->deleteLater();
+        rxNotifier_ = nullptr;
+    }
+    if (const quint64 drops = kernelDrops()) {
+        qWarning() << "[UDP][RX] kernel dropped" << drops << "datagrams on a full receive queue";
+    }
+    sock.close();
+}
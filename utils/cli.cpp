@@ -18,16 +18,16 @@ std::optional<CliOptions> CliParser::parse(int argc, char* argv[]) {
             return opts;
         } else if (arg == "--role") {
             opts.role = getArgValue(args, "--role", i);
-            if (opts.role != "sender" && opts.role != "subscriber") {
-                qCritical() << "Invalid role:" << opts.role << "(must be 'sender' or 'subscriber')";
+            if (opts.role != "sender" && opts.role != "subscriber" && opts.role != "replay-deadletters") {
+                qCritical() << "Invalid role:" << opts.role << "(must be 'sender', 'subscriber' or 'replay-deadletters')";
                 return std::nullopt;
             }
         } else if (arg == "--topic") {
             opts.topic = getArgValue(args, "--topic", i);
         } else if (arg == "--qos") {
             opts.qos = getArgValue(args, "--qos", i);
-            if (opts.qos != "reliable" && opts.qos != "best_effort") {
-                qCritical() << "Invalid qos:" << opts.qos << "(must be 'reliable' or 'best_effort')";
+            if (opts.qos != "reliable" && opts.qos != "reliable_nack" && opts.qos != "best_effort") {
+                qCritical() << "Invalid qos:" << opts.qos << "(must be 'reliable', 'reliable_nack' or 'best_effort')";
                 return std::nullopt;
             }
         } else if (arg == "--count") {
@@ -76,6 +76,17 @@ std::optional<CliOptions> CliParser::parse(int argc, char* argv[]) {
                 qCritical() << "Invalid run-for-sec:" << opts.runForSec << "(must be >= 1)";
                 return std::nullopt;
             }
+        } else if (arg == "--deadletter-file") {
+            opts.deadletterFile = getArgValue(args, "--deadletter-file", i);
+        } else if (arg == "--replay-rate") {
+            bool ok;
+            opts.replayRate = getArgValue(args, "--replay-rate", i).toInt(&ok);
+            if (!ok || opts.replayRate < 1) {
+                qCritical() << "Invalid replay-rate:" << opts.replayRate << "(must be >= 1)";
+                return std::nullopt;
+            }
+        } else if (arg == "--filter") {
+            opts.contentFilter = getArgValue(args, "--filter", i);
         } else {
             qCritical() << "Unknown argument:" << arg;
             return std::nullopt;
@@ -96,9 +107,9 @@ void CliParser::printHelp() {
     qInfo() << "Usage: mini_dds [options]";
     qInfo() << "";
     qInfo() << "Options:";
-    qInfo() << "  --role <sender|subscriber>    Required: Run as sender or subscriber";
+    qInfo() << "  --role <sender|subscriber|replay-deadletters>  Required: Run as sender, subscriber or dead-letter replayer";
     qInfo() << "  --topic <string>              Topic to publish/subscribe (default: sensor/temperature)";
-    qInfo() << "  --qos <reliable|best_effort>  QoS level (default: reliable)";
+    qInfo() << "  --qos <reliable|reliable_nack|best_effort>  QoS level (default: reliable)";
     qInfo() << "  --count <int>                 Number of messages to send (default: 1, sender only)";
     qInfo() << "  --interval-ms <int>           Interval between messages in ms (default: 1000, sender only)";
     qInfo() << "  --payload <json>              JSON payload for messages (default: {\"value\":23.5,\"unit\":\"C\"}, sender only)";
@@ -107,11 +118,15 @@ void CliParser::printHelp() {
     qInfo() << "  --start-delay-ms <int>        Delay before starting sender in ms (default: 0, sender only)";
     qInfo() << "  --print-recv                  Print received messages to stdout (subscriber only)";
     qInfo() << "  --run-for-sec <int>           Run for N seconds then exit cleanly (default: 0 = run indefinitely)";
+    qInfo() << "  --deadletter-file <path>      Dead-letter log to replay (default: logging.deadletter_file, replay only)";
+    qInfo() << "  --replay-rate <int>           Replayed packets per second (default: 50, replay only)";
+    qInfo() << "  --filter <expr>               Content filter, e.g. \"value > 30 AND unit = 'C'\" (subscriber only)";
     qInfo() << "  --help, -h                    Show this help message";
     qInfo() << "";
     qInfo() << "Examples:";
     qInfo() << "  ./mini_dds --role sender --topic sensor/temp --qos reliable --count 5";
     qInfo() << "  ./mini_dds --role subscriber --topic sensor/temp --log-level debug";
+    qInfo() << "  ./mini_dds --role replay-deadletters --config config/config.json --run-for-sec 60";
 }
 
 QString CliParser::getArgValue(const QStringList& args, const QString& flag, int& i) {